@@ -0,0 +1,264 @@
+/* make bench && ./bench
+ *
+ * list walks over 1000 clients with struct Client as it was before and
+ * after the split into a hot and a cold part, both copied from dwm.c.
+ * "cold" times are taken after a 32 MB buffer has flushed the caches. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NCLIENTS   1000
+#define WARMRUNS   2000
+#define COLDRUNS   20
+#define LOOKUPS    100
+
+typedef unsigned long Window;
+typedef unsigned long Atom;
+
+typedef struct {
+	unsigned int seltags;
+	unsigned int tagset[2];
+} Monitor;
+
+/* before */
+typedef struct Old Old;
+struct Old {
+	char name[256];
+	float mina, maxa;
+	int x_pos, y_pos, width, height;
+	int oldx, oldy, oldw, oldh;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	int bw, oldbw;
+	unsigned int tags;
+	int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, isshown;
+	unsigned int protocols;
+	Atom wintype, winstate;
+	Old *next, *prev;
+	Old *snext, *sprev;
+	Old *vnext, *vprev;
+	Old *vsnext, *vsprev;
+	Monitor *mon;
+	Window win;
+};
+
+/* after */
+typedef struct {
+	char name[256];
+	float mina, maxa;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	int oldx, oldy, oldw, oldh;
+	int oldbw, oldstate;
+} Cold;
+
+typedef struct New New;
+struct New {
+	New *next;
+	New *snext;
+	New *vnext;
+	New *vsnext;
+	Monitor *mon;
+	Window win;
+	unsigned int tags;
+	unsigned int isfixed:1, isfloating:1, isurgent:1, neverfocus:1, isfullscreen:1, isshown:1;
+	int x_pos, y_pos, width, height;
+	int bw;
+	unsigned int protocols;
+	Atom wintype, winstate;
+	New *prev, *sprev, *vprev, *vsprev;
+	Cold *cold;
+};
+
+static Monitor mon = { 0, { 1, 1 } };
+static Old *oldclients;
+static New *newclients, *newvisible;
+static void *session[NCLIENTS * 4];
+static char flush[32 << 20];
+static volatile unsigned long sink;
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* best of the warm runs, mean of the cold ones */
+static void
+bench(const char *label, void (*walk)(void))
+{
+	double t, warm = 1e30, cold = 0;
+	int i;
+
+	for (i = 0; i < WARMRUNS; i++) {
+		t = now();
+		walk();
+		if ((t = now() - t) < warm)
+			warm = t;
+	}
+	for (i = 0; i < COLDRUNS; i++) {
+		memset(flush, i, sizeof flush);
+		t = now();
+		walk();
+		cold += now() - t;
+	}
+	printf("  %-28s warm %8.1fus  cold %8.1fus\n", label, warm, cold / COLDRUNS);
+}
+
+static Window
+lookup(int i)
+{
+	return 0x200000 + (i * 7919) % NCLIENTS;
+}
+
+static void
+oldwintoclient(void)
+{
+	unsigned long acc = 0;
+	Old *c;
+	int i;
+
+	for (i = 0; i < LOOKUPS; i++) {
+		for (c = oldclients; c && c->win != lookup(i); c = c->next);
+		acc += (unsigned long)c;
+	}
+	sink = acc;
+}
+
+static void
+newwintoclient(void)
+{
+	unsigned long acc = 0;
+	New *c;
+	int i;
+
+	for (i = 0; i < LOOKUPS; i++) {
+		for (c = newclients; c && c->win != lookup(i); c = c->next);
+		acc += (unsigned long)c;
+	}
+	sink = acc;
+}
+
+static void
+oldtiled(void)
+{
+	unsigned long n = 0;
+	Old *c;
+
+	for (c = oldclients; c; c = c->next)
+		if (!c->isfloating && (c->tags & c->mon->tagset[c->mon->seltags]))
+			n++;
+	sink = n;
+}
+
+static void
+newtiled(void)
+{
+	unsigned long n = 0;
+	New *c;
+
+	for (c = newclients; c; c = c->next)
+		if (!c->isfloating && (c->tags & c->mon->tagset[c->mon->seltags]))
+			n++;
+	sink = n;
+}
+
+static void
+newtiledvisible(void)
+{
+	unsigned long n = 0;
+	New *c;
+
+	for (c = newvisible; c; c = c->vnext)
+		if (!c->isfloating)
+			n++;
+	sink = n;
+}
+
+static void
+oldoccupied(void)
+{
+	unsigned int occ = 0, urg = 0;
+	Old *c;
+
+	for (c = oldclients; c; c = c->next) {
+		occ |= c->tags;
+		if (c->isurgent)
+			urg |= c->tags;
+	}
+	sink = occ ^ urg;
+}
+
+static void
+newoccupied(void)
+{
+	unsigned int occ = 0, urg = 0;
+	New *c;
+
+	for (c = newclients; c; c = c->next) {
+		occ |= c->tags;
+		if (c->isurgent)
+			urg |= c->tags;
+	}
+	sink = occ ^ urg;
+}
+
+int
+main(void)
+{
+	New *chunk, *c, *last = NULL;
+	Old *o;
+	int i, j;
+
+	/* before, clients were calloc'd one by one between the titles, hints
+	 * and Xlib buffers of a running session */
+	srand(1);
+	for (i = 0; i < NCLIENTS; i++) {
+		o = calloc(1, sizeof(Old));
+		o->mon = &mon;
+		o->win = 0x200000 + i;
+		o->tags = 1 << (i % 9);
+		o->isfloating = i % 7 == 0;
+		o->next = oldclients;
+		oldclients = o;
+		for (j = 0; j < 4; j++)
+			session[i * 4 + j] = malloc(16 + rand() % 512);
+	}
+	/* after, hot parts come from one chunk, cold parts from the heap */
+	chunk = calloc(NCLIENTS, sizeof(New));
+	for (i = 0; i < NCLIENTS; i++) {
+		c = &chunk[i];
+		c->cold = calloc(1, sizeof(Cold));
+		c->mon = &mon;
+		c->win = 0x200000 + i;
+		c->tags = 1 << (i % 9);
+		c->isfloating = i % 7 == 0;
+		c->next = newclients;
+		newclients = c;
+	}
+	/* the visible list as updatevisible() builds it */
+	for (c = newclients; c; c = c->next)
+		if (c->tags & mon.tagset[mon.seltags]) {
+			if (last)
+				last->vnext = c;
+			else
+				newvisible = c;
+			last = c;
+		}
+
+	printf("Client %zu bytes before, %zu hot + %zu cold after\n",
+	       sizeof(Old), sizeof(New), sizeof(Cold));
+	printf("wintoclient() x%d, %d clients\n", LOOKUPS, NCLIENTS);
+	bench("before", oldwintoclient);
+	bench("after", newwintoclient);
+	printf("tiled count, 1 of 9 tags viewed\n");
+	bench("before", oldtiled);
+	bench("after", newtiled);
+	bench("after, visible list", newtiledvisible);
+	printf("drawbar() occ/urg\n");
+	bench("before", oldoccupied);
+	bench("after", newoccupied);
+	return 0;
+}
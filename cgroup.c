@@ -0,0 +1,205 @@
+/* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+#include "util.h"
+
+typedef struct CgGroup CgGroup;
+struct CgGroup {
+	pid_t pid;
+	char orig[512];              /* where the process came from, below the mount */
+	unsigned int nclass[CgLast]; /* its clients by class */
+	int class;                   /* class the group is configured for */
+	CgGroup *next;
+};
+
+static CgGroup *groups;
+static char root[256], dir[512];
+static const int *weights;
+static int freezing, enabled;
+
+static int
+cg_write(const char *path, const char *file, const char *val)
+{
+	char buf[800];
+	int fd, ok;
+
+	snprintf(buf, sizeof buf, "%s/%s", path, file);
+	/* control files exist or the write fails, nothing is created */
+	if ((fd = open(buf, O_WRONLY|O_TRUNC|O_CLOEXEC)) < 0)
+		return -1;
+	ok = write(fd, val, strlen(val)) == (ssize_t)strlen(val);
+	close(fd);
+	return ok ? 0 : -1;
+}
+
+static int
+cg_origin(pid_t pid, char *orig, size_t size)
+{
+	char buf[512];
+	FILE *fp;
+	int found = 0;
+
+	snprintf(buf, sizeof buf, "/proc/%d/cgroup", (int)pid);
+	if (!(fp = fopen(buf, "r")))
+		return -1;
+	/* the unified hierarchy is the "0::" line */
+	while (!found && fgets(buf, sizeof buf, fp))
+		if (!strncmp(buf, "0::", 3)) {
+			buf[strcspn(buf, "\n")] = '\0';
+			snprintf(orig, size, "%s", buf + 3);
+			found = 1;
+		}
+	fclose(fp);
+	return found ? 0 : -1;
+}
+
+static void
+cg_leaf(const CgGroup *g, char *buf, size_t size)
+{
+	snprintf(buf, size, "%s/%d", dir, (int)g->pid);
+}
+
+static void
+cg_apply(CgGroup *g)
+{
+	char leaf[768], val[16];
+	int class;
+
+	for (class = CgLast - 1; class > CgNone && !g->nclass[class]; class--);
+	if (class == g->class || class == CgNone)
+		return;
+	cg_leaf(g, leaf, sizeof leaf);
+	snprintf(val, sizeof val, "%d", weights[class - 1]);
+	cg_write(leaf, "cpu.weight", val);
+	if (freezing && (class == CgHidden || g->class == CgHidden))
+		cg_write(leaf, "cgroup.freeze", class == CgHidden ? "1" : "0");
+	g->class = class;
+}
+
+/* hands every process in the leaf back to where the group came from */
+static void
+cg_release(CgGroup *g)
+{
+	char leaf[768], back[768], path[800], buf[32];
+	FILE *fp;
+
+	cg_leaf(g, leaf, sizeof leaf);
+	if (freezing && g->class == CgHidden)
+		cg_write(leaf, "cgroup.freeze", "0");
+	snprintf(back, sizeof back, "%s%s", root, g->orig);
+	snprintf(path, sizeof path, "%s/cgroup.procs", leaf);
+	if ((fp = fopen(path, "r"))) {
+		while (fgets(buf, sizeof buf, fp))
+			cg_write(back, "cgroup.procs", buf);
+		fclose(fp);
+	}
+	rmdir(leaf);
+}
+
+static CgGroup *
+cg_find(pid_t pid, CgGroup ***prev)
+{
+	CgGroup **g;
+
+	for (g = &groups; *g && (*g)->pid != pid; g = &(*g)->next);
+	if (prev)
+		*prev = g;
+	return *g;
+}
+
+int
+cg_init(const char *mount, const char *base, const int *weight, int freeze)
+{
+	snprintf(root, sizeof root, "%s", mount);
+	snprintf(dir, sizeof dir, "%s/%s", mount, base);
+	if (mkdir(dir, 0755) < 0 && access(dir, W_OK) < 0)
+		return -1;
+	/* without the cpu controller the freezer still works */
+	cg_write(dir, "cgroup.subtree_control", "+cpu");
+	weights = weight;
+	freezing = freeze;
+	enabled = 1;
+	return 0;
+}
+
+void
+cg_attach(pid_t pid, int class)
+{
+	char leaf[768], val[16];
+	CgGroup *g;
+	int created;
+
+	/* never init, never dwm itself */
+	if (!enabled || pid <= 1 || pid == getpid())
+		return;
+	if (!(g = cg_find(pid, NULL))) {
+		g = ecalloc(1, sizeof(CgGroup));
+		g->pid = pid;
+		cg_leaf(g, leaf, sizeof leaf);
+		snprintf(val, sizeof val, "%d", (int)pid);
+		created = 0;
+		if (cg_origin(pid, g->orig, sizeof g->orig) < 0
+		|| (!(created = !mkdir(leaf, 0755)) && access(leaf, W_OK) < 0)
+		|| cg_write(leaf, "cgroup.procs", val) < 0) {
+			if (created) /* a leaf left by someone else stays */
+				rmdir(leaf);
+			free(g);
+			return;
+		}
+		g->next = groups;
+		groups = g;
+	}
+	g->nclass[class]++;
+	cg_apply(g);
+}
+
+void
+cg_setclass(pid_t pid, int from, int to)
+{
+	CgGroup *g;
+
+	if (!enabled || !(g = cg_find(pid, NULL)))
+		return;
+	g->nclass[from]--;
+	g->nclass[to]++;
+	cg_apply(g);
+}
+
+void
+cg_detach(pid_t pid, int class)
+{
+	CgGroup *g, **prev;
+	int i;
+
+	if (!enabled || !(g = cg_find(pid, &prev)))
+		return;
+	g->nclass[class]--;
+	for (i = CgNone + 1; i < CgLast && !g->nclass[i]; i++);
+	if (i < CgLast) {
+		cg_apply(g);
+		return;
+	}
+	cg_release(g);
+	*prev = g->next;
+	free(g);
+}
+
+void
+cg_cleanup(void)
+{
+	CgGroup *g;
+
+	while ((g = groups)) {
+		groups = g->next;
+		cg_release(g);
+		free(g);
+	}
+	enabled = 0;
+}
@@ -0,0 +1,11 @@
+/* See LICENSE file for copyright and license details. */
+
+/* how much a process matters, its best client wins */
+enum { CgNone, CgHidden, CgVisible, CgFocused, CgLast };
+
+/* leaf groups per process below mount/base, cgroup v2 only */
+int cg_init(const char *mount, const char *base, const int *weight, int freeze);
+void cg_attach(pid_t pid, int class);
+void cg_setclass(pid_t pid, int from, int to);
+void cg_detach(pid_t pid, int class);
+void cg_cleanup(void);
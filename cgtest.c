@@ -0,0 +1,188 @@
+/* make test
+ *
+ * runs cgroup.c against a fake hierarchy in a temporary directory, with
+ * sleep(1) processes standing in for clients.  The control files of a leaf
+ * are created up front the way cgroupfs creates them on mkdir. */
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+
+static const int weights[] = { 10, 100, 400 };
+static char mount[64] = "/tmp/cgtest.XXXXXX";
+static int failures;
+
+static void
+check(int ok, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s ", ok ? "ok  " : "FAIL");
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	failures += !ok;
+}
+
+static char *
+path(const char *fmt, ...)
+{
+	static char buf[4][800];
+	static int i;
+	char rel[600];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(rel, sizeof rel, fmt, ap);
+	va_end(ap);
+	i = (i + 1) % 4;
+	snprintf(buf[i], sizeof buf[i], "%s/%s", mount, rel);
+	return buf[i];
+}
+
+static void
+touch(const char *file)
+{
+	close(open(file, O_WRONLY|O_CREAT|O_TRUNC, 0644));
+}
+
+/* what the file holds, without the trailing newline */
+static const char *
+content(const char *file)
+{
+	static char buf[256];
+	FILE *fp;
+
+	buf[0] = '\0';
+	if ((fp = fopen(file, "r"))) {
+		if (!fgets(buf, sizeof buf, fp))
+			buf[0] = '\0';
+		fclose(fp);
+	}
+	buf[strcspn(buf, "\n")] = '\0';
+	return buf;
+}
+
+static int
+exists(const char *file)
+{
+	struct stat st;
+
+	return !stat(file, &st);
+}
+
+static pid_t
+spawn(void)
+{
+	pid_t pid;
+
+	if (!(pid = fork())) {
+		execlp("sleep", "sleep", "60", (char *)NULL);
+		_exit(127);
+	}
+	return pid;
+}
+
+/* a leaf the way mkdir in cgroupfs leaves it */
+static void
+mkleaf(pid_t pid)
+{
+	mkdir(path("dwm/%d", (int)pid), 0755);
+	touch(path("dwm/%d/cgroup.procs", (int)pid));
+	touch(path("dwm/%d/cpu.weight", (int)pid));
+	touch(path("dwm/%d/cgroup.freeze", (int)pid));
+}
+
+int
+main(void)
+{
+	char line[512], orig[512] = "", cmd[1200];
+	pid_t a, b, c;
+	FILE *fp;
+	int fd;
+
+	if (!mkdtemp(mount)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	/* the processes come back to where this one lives */
+	if ((fp = fopen("/proc/self/cgroup", "r"))) {
+		while (fgets(line, sizeof line, fp))
+			if (!strncmp(line, "0::", 3)) {
+				line[strcspn(line, "\n")] = '\0';
+				snprintf(orig, sizeof orig, "%s", line + 3);
+			}
+		fclose(fp);
+	}
+	if (!orig[0]) {
+		printf("skip: no cgroup v2 line in /proc/self/cgroup\n");
+		return 0;
+	}
+	snprintf(cmd, sizeof cmd, "mkdir -p '%s%s'", mount, orig);
+	if (system(cmd))
+		return 1;
+	touch(path("%s/cgroup.procs", orig));
+	mkdir(path("dwm"), 0755);
+	touch(path("dwm/cgroup.subtree_control"));
+
+	check(!cg_init(mount, "dwm", weights, 1), "cg_init");
+	check(!strcmp(content(path("dwm/cgroup.subtree_control")), "+cpu"), "cpu controller enabled");
+
+	a = spawn();
+	b = spawn();
+	c = spawn();
+
+	mkleaf(a);
+	cg_attach(a, CgVisible);
+	check(atoi(content(path("dwm/%d/cgroup.procs", (int)a))) == a, "attach moves the process into its leaf");
+	check(!strcmp(content(path("dwm/%d/cpu.weight", (int)a)), "100"), "visible weight");
+	cg_attach(a, CgFocused);
+	check(!strcmp(content(path("dwm/%d/cpu.weight", (int)a)), "400"), "a focused client wins");
+	cg_detach(a, CgFocused);
+	cg_setclass(a, CgVisible, CgHidden);
+	check(!strcmp(content(path("dwm/%d/cpu.weight", (int)a)), "10"), "hidden weight");
+	check(!strcmp(content(path("dwm/%d/cgroup.freeze", (int)a)), "1"), "hidden frozen");
+	cg_setclass(a, CgHidden, CgVisible);
+	check(!strcmp(content(path("dwm/%d/cgroup.freeze", (int)a)), "0"), "thawed when shown again");
+
+	/* no control files: the write fails, the leaf made for it goes */
+	cg_attach(b, CgVisible);
+	check(!exists(path("dwm/%d", (int)b)), "failed attach removes the leaf it made");
+
+	/* a leaf that was there before is not ours to remove */
+	mkdir(path("dwm/%d", (int)c), 0755);
+	cg_attach(c, CgVisible);
+	check(exists(path("dwm/%d", (int)c)), "failed attach keeps a leaf it found");
+
+	cg_attach(1, CgVisible);
+	cg_attach(getpid(), CgVisible);
+	check(!exists(path("dwm/1")) && !exists(path("dwm/%d", (int)getpid())), "init and self are left alone");
+
+	cg_setclass(a, CgVisible, CgHidden);
+	cg_cleanup();
+	check(!strcmp(content(path("dwm/%d/cgroup.freeze", (int)a)), "0"), "cleanup thaws");
+	check(atoi(content(path("%s/cgroup.procs", orig))) == a, "cleanup hands the process back");
+	if ((fd = open(path("dwm/%d/cpu.weight", (int)a), O_WRONLY|O_TRUNC)) >= 0)
+		close(fd);
+	cg_setclass(a, CgHidden, CgVisible);
+	check(!content(path("dwm/%d/cpu.weight", (int)a))[0], "nothing is written after cleanup");
+
+	kill(a, SIGTERM);
+	kill(b, SIGTERM);
+	kill(c, SIGTERM);
+	while (wait(NULL) > 0);
+	snprintf(cmd, sizeof cmd, "rm -rf '%s'", mount);
+	if (system(cmd))
+		perror("rm");
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures != 0;
+}
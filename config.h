@@ -23,6 +23,55 @@ static const unsigned int snap      = 32;       /* snap pixel */
 static const int showbar            = 1;        /* 0 means no bar */
 static const int topbar             = 1;        /* 0 means bottom bar */
 static const int window_gap         = 6;        /* gap between windows */
+static const int tagcontainers      = 0;        /* 1 means each tag keeps its clients in a container window */
+static const int hiddenstate        = 0;        /* 1 marks clients on hidden tags hidden and iconic */
+
+/* cgroup v2 weights by focus and visibility, an empty base disables them */
+static const char cgroupmount[]     = "/sys/fs/cgroup";
+static const char cgroupbase[]      = "";       /* below cgroupmount, e.g. "user.slice/dwm" */
+static const int cgroupweight[]     = { 10, 100, 400 }; /* cpu.weight on hidden tags, visible, focused */
+static const int cgroupfreeze       = 0;        /* 1 freezes processes on hidden tags */
+
+/* per client cpu and memory from /proc, published as _DWM_USAGE on the root window */
+static const unsigned int usageinterval = 0;    /* ms between samples, 0 disables */
+static const int showusage          = 0;        /* 1 shows the focused client's and the view's usage in the bar */
+
+/* built-in status, read from /proc and /sys instead of the root window name */
+static const int builtinstatus      = 0;        /* 1 composes the status from the modules below */
+static const char statussep[]       = " | ";
+static const char statusfifo[]      = "";       /* FIFO taking "name text" lines as status segments, empty disables */
+
+/* control socket, lines of "command argument" answered with "ok" or "error ...",
+ * "subscribe focus tags layout client monitor" streams those events */
+static const char ipcsocket[]       = "";       /* path, empty disables */
+static const IpcCommand ipccommands[] = {
+	/* name             function          argument */
+	{ "view",           view,             IpcUint },   /* tag mask, as in the key bindings */
+	{ "toggleview",     toggleview,       IpcUint },
+	{ "tag",            tag,              IpcUint },
+	{ "toggletag",      toggletag,        IpcUint },
+	{ "setlayout",      setlayout,        IpcLayout }, /* index into layouts, none toggles */
+	{ "setmfact",       setmfact,         IpcFloat },
+	{ "focusstack",     focusstack,       IpcStack },  /* +n, -n, prev or a position */
+	{ "pushstack",      pushstack,        IpcStack },
+	{ "focusmon",       focusmon,         IpcInt },
+	{ "tagmon",         tagmon,           IpcInt },
+	{ "zoom",           zoom,             IpcNone },
+	{ "killclient",     killclient,       IpcNone },
+	{ "togglefloating", togglefloating,   IpcNone },
+	{ "togglebar",      togglebar,        IpcNone },
+	{ "spawn",          spawn,            IpcCmd },    /* rest of the line, run by /bin/sh -c */
+	{ "quit",           quit,             IpcNone },
+};
+static const StatusModule statusmodules[] = {
+	/* function     argument            interval (ms) */
+	{ st_cpu,       NULL,               2000 },
+	{ st_mem,       NULL,               5000 },
+	{ st_load,      NULL,               5000 },
+	{ st_net,       "eth0",             2000 },
+	{ st_battery,   "BAT0",             30000 },
+	{ st_clock,     "%a %d %b %H:%M",   1000 },
+};
 
 /* tagging */
 static const char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
@@ -32,9 +81,11 @@ static const Rule rules[] = {
 	 *	WM_CLASS(STRING) = instance, class
 	 *	WM_NAME(STRING) = title
 	 */
-	/* class      instance    title       tags mask     isfloating   monitor */
-	{ "Gimp",     NULL,       NULL,       0,            1,           -1 },
-	{ "Firefox",  NULL,       NULL,       1 << 8,       0,           -1 },
+	/* class      instance    title       tags mask     isfloating   wireframe   monitor */
+	{ "Gimp",     NULL,       NULL,       0,            1,           0,          -1 },
+	{ "Firefox",  NULL,       NULL,       1 << 8,       0,           0,          -1 },
+	/* a wireframe moves and resizes an outline, the window follows on release:
+	{ "Gimp",     NULL,       NULL,       0,            1,           1,          -1 }, */
 };
 
 /* layout(s) */
@@ -147,7 +198,9 @@ static Key keys[] = {
 };
 
 /* button definitions */
-/* click can be ClkLtSymbol, ClkStatusText, ClkWinTitle, ClkClientWin, or ClkRootWin */
+/* click can be ClkLtSymbol, ClkStatusText, ClkUsage, ClkWinTitle, ClkClientWin, or ClkRootWin */
+/* ClkTagBar and ClkStatusText buttons with a {0} argument get the clicked tag
+ * mask or the index of the clicked colored status span */
 static Button buttons[] = {
 	/* click                event mask      button          function        argument */
 	{ ClkLtSymbol,          0,              Button1,        setlayout,      {0} },
@@ -354,7 +354,6 @@ void
 drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
 {
 	XCopyArea(drw->dpy, drw->drawable, win, drw->gc, x, y, w, h, x, y);
-	XSync(drw->dpy, False);
 }
 
 void
@@ -415,14 +414,16 @@ drw_get_width(Drw *drw, int numcolors, const char *text)
   return w;
 }
 
-void
-drw_colored_text(Drw *drw, ClrScheme *scheme, int numcolors, int x, int y, unsigned int w, unsigned int h, char *text)
+/* the x where each colored span but the last one ends is stored in spans,
+ * returns how many were stored */
+int
+drw_colored_text(Drw *drw, ClrScheme *scheme, int numcolors, int x, int y, unsigned int w, unsigned int h, char *text, int *spans, int maxspans)
 {
     if (!drw || !drw->fontcount || !drw->scheme)
-        return;
+        return 0;
 
     char *buf = text, *ptr = buf, c = 1;
-    int i;
+    int i, n = 0;
 
     while (*ptr) {
         for (i = 0; *ptr < 0 || *ptr > numcolors; i++, ptr++);
@@ -430,13 +431,17 @@ drw_colored_text(Drw *drw, ClrScheme *scheme, int numcolors, int x, int y, unsig
             break;
         c = *ptr;
         *ptr = 0;
-        if (i)
+        if (i) {
             x = drw_text(drw, x, y, w, h, buf, 0) + drw->fonts[0]->h;
+            if (n < maxspans)
+                spans[n++] = x;
+        }
         *ptr = c;
         drw_setscheme(drw, &scheme[c-1]);
         buf = ++ptr;
     }
     drw_text(drw, x, y, w, h, buf, 0);
+    return n;
 }
 
 Cur *
@@ -70,7 +70,7 @@ void drw_setscheme(Drw *, ClrScheme *);
 void drw_rect(Drw *, int, int, unsigned int, unsigned int, int, int, int);
 int drw_text(Drw *, int, int, unsigned int, unsigned int, const char *, int);
 int drw_get_width(Drw *, int, const char *);
-void drw_colored_text(Drw *, ClrScheme *, int, int, int, unsigned int, unsigned int, char *);
+int drw_colored_text(Drw *, ClrScheme *, int, int, int, unsigned int, unsigned int, char *, int *, int);
 
 /* Map functions */
 void drw_map(Drw *, Window, int, int, unsigned int, unsigned int);
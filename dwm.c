@@ -11,24 +11,30 @@
  * in O(1) time.
  *
  * Each child of the root window is called a client, except windows which have
- * set the override_redirect flag.  Clients are organized in a linked client
- * list on each monitor, the focus history is remembered through a stack list
- * on each monitor. Each client contains a bit array to indicate the tags of a
- * client.
+ * set the override_redirect flag.  Clients are organized in a doubly linked
+ * client list on each monitor, the focus history is remembered through a
+ * doubly linked stack list on each monitor. Each client contains a bit array
+ * to indicate the tags of a client.
  *
  * Keys and tagging rules are organized as arrays and defined in config.h.
  *
  * To understand everything else, start reading main().
  */
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
@@ -36,16 +42,29 @@
 #include <X11/Xlib.h>
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/shape.h>
+#include <X11/extensions/sync.h>
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
 #include <X11/Xft/Xft.h>
 
+#include "cgroup.h"
 #include "drw.h"
+#include "status.h"
 #include "util.h"
 
 /* macros */
 #define BUTTONMASK              (ButtonPressMask|ButtonReleaseMask)
+#define SLABCHUNK               64
+#define SYNCTIMEOUT             200 /* ms a client gets to ack _NET_WM_SYNC_REQUEST */
+#define SYNCMISSES              3   /* timeouts in a row before the protocol is dropped */
+#define TOPOLOGYDELAY           100 /* ms for a burst of screen changes to settle */
+#define CONTAINS(m,x,y,w,h)     ((x) >= (m)->window_x && (x) + (w) <= (m)->window_x + (m)->window_width \
+                               && (y) >= (m)->window_y && (y) + (h) <= (m)->window_y + (m)->window_height)
 #define CLEANMASK(mask)         (mask & ~(numlockmask|LockMask) & (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
 #define GETINC(X)               ((X) - 2000)
 #define INC(X)                  ((X) + 2000)
@@ -56,8 +75,16 @@
 #define PREVSEL                 3000
 #define LENGTH(X)               (sizeof X / sizeof X[0])
 #define MAXCOLORS               9
+#define MAXTAGS                 31
+#define MAXSTATUSSPANS          32
+#define MAXSTATUSSEGS           16
+#define MAXIPCCLIENTS           8
+#define IPCOUTMAX               (64 * 1024)  /* queued output before a subscriber counts as stuck */
+#define MAXBARSEGS              (MAXTAGS + MAXSTATUSSPANS + 4)
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
 #define MOD(N,M)                ((N)%(M) < 0 ? (N)%(M) + (M) : (N)%(M))
+#define WINX(C)                 ((C)->x_pos - ((C)->cold->container ? (C)->mon->mon_x : 0))
+#define WINY(C)                 ((C)->y_pos - ((C)->cold->container ? (C)->mon->mon_y : 0))
 #define WIDTH(X)                ((X)->width + 2 * (X)->bw + window_gap)
 #define HEIGHT(X)               ((X)->height + 2 * (X)->bw + window_gap)
 #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
@@ -68,10 +95,14 @@
 enum { CurNormal, CurResize, CurMove, CurLast }; /* cursor */
 enum { SchemeNorm, SchemeSel, SchemeLast }; /* color schemes */
 enum { NetSupported, NetWMName, NetWMState,
-       NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetWMWindowTypeNotification, NetClientList, NetLast }; /* EWMH atoms */
-enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
-enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
+       NetWMFullscreen, NetWMStateHidden, NetActiveWindow, NetWMWindowType,
+       NetWMWindowTypeDialog, NetWMWindowTypeNotification, NetClientList, NetWMPid,
+       NetWMSyncRequest, NetWMSyncRequestCounter, NetLast }; /* EWMH atoms */
+enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMSyncRequest, WMLast }; /* default atoms */
+enum { DWMStats, DWMUsage, DWMLast }; /* dwm specific atoms */
+enum { IpcNone, IpcInt, IpcUint, IpcFloat, IpcStack, IpcLayout, IpcCmd }; /* ipc argument types */
+enum { IpcEvFocus, IpcEvTags, IpcEvLayout, IpcEvClient, IpcEvMonitor, IpcEvLast }; /* ipc events */
+enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkUsage, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
 
 typedef union {
@@ -89,21 +120,67 @@ typedef struct {
     const Arg arg;
 } Button;
 
+typedef struct {
+    int x;              /* right edge, segments are stored left to right */
+    unsigned int click;
+    int arg;            /* tag index or status span */
+} BarSeg;
+
+typedef struct Timer Timer;
+struct Timer {
+    long long due;           /* monotonic ms, 0 while disarmed */
+    void (*fire)(Timer *timer);
+    void *arg;
+    Timer *next;
+};
+
 typedef struct Monitor Monitor;
 typedef struct Client Client;
-struct Client {
+typedef struct {
     char name[256];
     float mina, maxa;
-    int x_pos, y_pos, width, height;
-    int oldx, oldy, oldw, oldh;
     int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-    int bw, oldbw;
-    unsigned int tags;
-    int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen;
+    int oldx, oldy, oldw, oldh;
+    int oldbw, oldstate;
+    int cfgbw;                       /* border width resizeclient() asked for */
+    XSyncCounter synccounter;        /* _NET_WM_SYNC_REQUEST_COUNTER */
+    XSyncAlarm syncalarm;
+    unsigned long long syncvalue;    /* last value sent in a sync request */
+    unsigned int syncmisses;         /* requests in a row that timed out */
+    Timer synctimer;
+    Window container;                /* tag container the window lives in, None for the root */
+    int ignoreunmap;                 /* UnmapNotify events caused by reparenting */
+    unsigned long stateserial;       /* request that last wrote _NET_WM_STATE, 0 once its event came */
+    Atom *netstate;                  /* the _NET_WM_STATE atoms dwm leaves alone */
+    unsigned int nnetstate;
+    pid_t pid;                       /* _NET_WM_PID, 0 if not set */
+    int statfd, statmfd;             /* /proc/<pid>/stat and statm, -1 until opened, -2 once gone, one client per pid opens them */
+    unsigned long long cputicks;     /* utime + stime at the last sample */
+    unsigned int cpu;                /* tenths of a percent of one cpu */
+    unsigned long rss;               /* kB */
+} ClientCold;
+
+/* the fields read by list walks come first so that a walk touches one
+ * cache line per client, everything else lives in the cold part */
+struct Client {
     Client *next;
     Client *snext;
+    Client *vnext;           /* visible clients in client list order */
+    Client *vsnext;          /* visible clients in focus stack order */
     Monitor *mon;
     Window win;
+    unsigned int tags;
+    unsigned int isfixed:1, isfloating:1, isurgent:1, neverfocus:1, isfullscreen:1, isshown:1;
+    unsigned int ishidden:1;  /* _NET_WM_STATE_HIDDEN and IconicState set by updatevisible() */
+    unsigned int cgclass:2;  /* cgroup class of its process, CgNone while not placed */
+    unsigned int wireframe:1;  /* drag an outline, resize once on release */
+    unsigned int syncwait:1, syncqueued:1;  /* sync request not acked yet, configure held back meanwhile */
+    int x_pos, y_pos, width, height;
+    int bw;
+    unsigned int protocols;  /* supported WM_PROTOCOLS, bit n is wmatom[n] */
+    Atom wintype, winstate;  /* first atom of _NET_WM_WINDOW_TYPE and _NET_WM_STATE */
+    Client *prev, *sprev, *vprev, *vsprev;
+    ClientCold *cold;
 };
 
 typedef struct {
@@ -118,6 +195,18 @@ typedef struct {
     void (*arrange)(Monitor *);
 } Layout;
 
+typedef struct {
+    const Layout *lt;                                       /* NULL when nothing is cached */
+    float mfact;
+    int nmaster;
+    int window_x, window_y, window_width, window_height;
+    unsigned int nvisible;
+    char ltsymbol[16];
+    Window *wins;                                           /* tiled clients in list order */
+    int *geom;                                              /* x, y, width, height and border of each */
+    unsigned int n, size;
+} LayoutPlan;
+
 struct Monitor {
     char ltsymbol[16];
     float mfact;
@@ -131,30 +220,68 @@ struct Monitor {
     unsigned int tagset[2];
     int showbar;
     int topbar;
+    int dirty;                                              /* clients or geometry changed since the last arrange */
+    unsigned int refresh;                                   /* Hz, paces interactive moves and resizes */
     Client *clients;
     Client *selected_client;
     Client *stack;
+    Client *visible;                                        /* ISVISIBLE() subsets of clients and stack */
+    Client *vstack;
+    unsigned int nvisible;
+    unsigned int occ, urg;                                  /* tags with clients, with urgent clients */
+    unsigned int ipcocc, ipcurg;                            /* occ and urg the last tags event carried */
+    unsigned int tagclients[MAXTAGS], tagurgent[MAXTAGS];  /* per tag counts behind occ and urg */
+    unsigned int tagcpu[MAXTAGS];                           /* per tag usage sums, see sampleusage() */
+    unsigned long tagrss[MAXTAGS];
     Monitor *next;
     Window barwin;
+    Window deskwin;                                         /* InputOnly, bottom of the stack, reports the pointer entering */
+    Window tagwin[MAXTAGS];                                 /* per tag containers, created on first use */
+    unsigned int mappedtags, shapetags;                     /* containers mapped, containers needing a new shape */
+    BarSeg barsegs[MAXBARSEGS];                             /* what drawbar() put where */
+    unsigned int nbarsegs;
+    int statusw;                                            /* status width drawbar() fitted, -1 if it was cut */
+    Window *stackorder;                                     /* last committed tiled stacking order */
+    unsigned int nstackorder;
+    LayoutPlan plans[MAXTAGS + 1];                          /* last layout of each single tag view, then of any other view */
     const Layout *lt[2];
 };
 
+typedef struct {
+    const char *name;
+    void (*func)(const Arg *arg);
+    int argtype;
+} IpcCommand;
+
+typedef struct {
+    int fd;                 /* -1 while the slot is free */
+    unsigned int events;    /* subscribed, 1 << IpcEv* */
+    char in[512];
+    size_t inlen;
+    char *out;              /* what the socket did not take yet */
+    size_t outlen;
+} IpcClient;
+
 typedef struct {
     const char *class;
     const char *instance;
     const char *title;
     unsigned int tags;
     int isfloating;
+    int wireframe;
     int monitor;
 } Rule;
 
 /* function declarations */
 static void applyrules(Client *client);
 static int applysizehints(Client *client, int *x_pos, int *y_pos, int *width, int *height, int interact);
+static void armtimer(Timer *timer, unsigned int ms);
 static void arrange(Monitor *monitor);
 static void arrangemon(Monitor *monitor);
 static void attach(Client *client);
+static void attachafter(Client *client, Client *after);
 static void attachstack(Client *client);
+static const BarSeg *barsegat(Monitor *monitor, int x);
 static void bstack(Monitor *monitor);
 static void bstackhoriz(Monitor *monitor);
 static void buttonpress(XEvent *event);
@@ -163,82 +290,148 @@ static void cleanup(void);
 static void cleanupmon(Monitor *mon);
 static void clearurgent(Client *client);
 static void clientmessage(XEvent *event);
+static int cmppid(const void *a, const void *b);
+static void composestatus(void);
+static void compressmotion(XEvent *event);
 static void configure(Client *client);
 static void configurenotify(XEvent *event);
 static void configurerequest(XEvent *event);
+static void counttags(Client *client, int delta);
+static Client *createclient(void);
 static Monitor *createmon(void);
 static void destroynotify(XEvent *event);
 static void detach(Client *client);
 static void detachstack(Client *client);
 static Monitor *dirtomon(int dir);
+static void disarmtimer(Timer *timer);
+static void dispatch(XEvent *event);
+static void dragevent(XEvent *event);
+static void flushshapes(void);
 static void drawbar(Monitor *monitor);
 static void drawbars(void);
+static void drawstatus(Monitor *monitor);
+static void drawoutline(GC gc, Client *client, int x_pos, int y_pos, int width, int height);
 static void enternotify(XEvent *event);
 static void expose(XEvent *event);
 static void focus(Client *client);
 static void focusin(XEvent *event);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
+static void freeclient(Client *client);
+static pid_t getclientpid(Client *client);
 static int getrootptr(int *x_pos, int *y_pos);
 static long getstate(Window window);
 static int gettextprop(Window window, Atom atom, char *text, unsigned int size);
 static void grabbuttons(Client *client, int focused);
 static void grabkeys(void);
+static void invalidateplans(Monitor *monitor);
+static void ipcaccept(void);
+static void ipcclose(IpcClient *ipc);
+static void ipccommand(IpcClient *ipc, char *line);
+static void ipcevent(int event, const char *fmt, ...);
+static void ipcflush(IpcClient *ipc);
+static void ipcio(IpcClient *ipc, short revents);
+static void ipclisten(void);
+static void ipcnotifyfocus(void);
+static void ipcnotifyocc(void);
+static void ipcnotifytags(Monitor *monitor);
+static void ipcreply(IpcClient *ipc, const char *msg);
+static void ipcsend(IpcClient *ipc, const char *text, size_t len);
 static void keypress(XEvent *event);
 static void killclient(const Arg *arg);
+static void lowerdesks(void);
 static void manage(Window window, XWindowAttributes *window_attributes);
+static void markshape(Window container);
+static void mapnotify(XEvent *event);
 static void mappingnotify(XEvent *event);
 static void maprequest(XEvent *event);
 static void monocle(Monitor *monitor);
-static void motionnotify(XEvent *event);
 static void movemouse(const Arg *arg);
 static Client *nexttiled(Client *client);
+static long long nowms(void);
+static GC outlinegc(void);
+static unsigned int planslot(Monitor *monitor);
+static Monitor *pointtomon(int x_pos, int y_pos);
 static void pop(Client *client);
 static void propertynotify(XEvent *event);
 static void pushstack(const Arg *arg);
 static void quit(const Arg *arg);
+static void raiseclient(Client *client);
+static void readstatus(void);
+static void recordplan(Monitor *monitor);
 static Monitor *recttomon(int x_pos, int y_pos, int width, int height);
+static int replayplan(Monitor *monitor);
 static void resize(Client *client, int x_pos, int y_pos, int width, int height, int interact);
 static void resizeclient(Client *client, int x_pos, int y_pos, int width, int height);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *monitor);
 static void run(void);
+static void sampleclient(Client *client, long long elapsed);
+static void sampleusage(Timer *timer);
+static int runtimers(void);
 static void scan(void);
-static int sendevent(Client *client, Atom proto);
+static void sendconfigure(Client *client);
+static int sendevent(Client *client, int proto);
 static void sendmon(Client *client, Monitor *monitor);
 static void setclientstate(Client *client, long state);
 static void setfocus(Client *client);
 static void setfullscreen(Client *client, int fullscreen);
+static void sethidden(Client *client, int hidden);
 static void setlayout(const Arg *arg);
+static void seturgent(Client *client, int urgent);
 static void setmfact(const Arg *arg);
+static int setstatusseg(char *line);
 static void setup(void);
 static void showhide(Client *c);
 static void sigchld(int unused);
 static void spawn(const Arg *arg);
+static void statustick(Timer *timer);
+static void syncalarm(XEvent *event);
+static void syncdone(Client *client);
+static void syncrequest(Client *client);
+static void synctimeout(Timer *timer);
 static int stackpos(const Arg *arg);
 static void tag(const Arg *arg);
+static Window tagcontainer(Monitor *monitor, unsigned int tag);
 static void tagmon(const Arg *arg);
 static void tile(Monitor *monitor);
 static void togglebar(const Arg *arg);
 static void togglefloating(const Arg *arg);
+static void trackpointer(XEvent *event);
 static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
 static void unfocus(Client *client, int setfocus);
 static void unmanage(Client *client, int destroyed);
 static void unmapnotify(XEvent *event);
 static int updategeom(void);
+#ifdef XRANDR
+static void updaterefresh(void);
+#endif /* XRANDR */
 static void updatebarpos(Monitor *monitor);
 static void updatebars(void);
+static void updatecgroup(Client *client);
 static void updateclientlist(void);
+static void updatecontainer(Client *client, int mapped);
+static void updatemonindex(void);
+static void updatenetstate(Client *client);
 static void updatenumlockmask(void);
+static void updateprotocols(Client *client);
 static void updatesizehints(Client *client);
+static void updatestats(void);
 static void updatestatus(void);
+static void updatetopology(Timer *timer);
+static void updatesynccounter(Client *client);
 static void updatewindowtype(Client *client);
+static void updatewinstate(Client *client);
 static void updatetitle(Client *client);
+static void updatevisible(Monitor *monitor);
 static void updatewmhints(Client *client);
+static void usageappend(size_t *len, const char *fmt, ...);
+static void usagetext(Monitor *monitor, char *text, size_t size);
 static void view(const Arg *arg);
 static void warp(const Client *client);
 static Client *wintoclient(Window window);
+static Monitor *wintodesk(Window window);
 static Monitor *wintomon(Window window);
 static int xerror(Display *dpy, XErrorEvent *error_event);
 static int xerrordummy(Display *dpy, XErrorEvent *error_event);
@@ -248,11 +441,23 @@ static void zoom(const Arg *arg);
 /* variables */
 static const char broken[] = "broken";
 static char stext[256];
+static struct {
+    char name[16];
+    char text[64];
+} statussegs[MAXSTATUSSEGS];          /* named segments written to statusfifo */
+static unsigned int nstatussegs;
+static int statusfd = -1, statuswfd = -1;
+static int ipcfd = -1;
+static IpcClient ipcclients[MAXIPCCLIENTS];
+static int occchanged;                /* some monitor's occ or urg differs from its last tags event */
+static const char *ipcevents[] = { "focus", "tags", "layout", "client", "monitor" };
 static int screen;
 static int screen_width, sh;      /* X display screen geometry width, height */
-static int bar_height, blw = 0; /* bar geometry */
+static int pointer_x, pointer_y;  /* last pointer position reported by an event */
+static int bar_height; /* bar geometry */
 static int (*xerrorxlib)(Display *, XErrorEvent *);
 static unsigned int numlockmask = 0;
+static unsigned long enterserial = 0; /* EnterNotify older than this was caused by restack() */
 static void (*handler[LASTEvent]) (XEvent *) = {
     [ButtonPress] = buttonpress,
     [ClientMessage] = clientmessage,
@@ -263,26 +468,59 @@ static void (*handler[LASTEvent]) (XEvent *) = {
     [Expose] = expose,
     [FocusIn] = focusin,
     [KeyPress] = keypress,
+    [MapNotify] = mapnotify,
     [MappingNotify] = mappingnotify,
     [MapRequest] = maprequest,
-    [MotionNotify] = motionnotify,
     [PropertyNotify] = propertynotify,
     [UnmapNotify] = unmapnotify
 };
-static Atom wmatom[WMLast], netatom[NetLast];
+static Atom wmatom[WMLast], netatom[NetLast], dwmatom[DWMLast];
 static int running = 1;
 static Cur *cursor[CurLast];
 static ClrScheme scheme[MAXCOLORS];
 static Display *dpy;
 static Drw *drw;
 static Monitor *monitor_start, *selected_monitor;
+static Monitor **monbynum, **monbyx;  /* monitors by num and sorted by window_x */
+static unsigned int nmons;
+static Monitor *lasthit;              /* recttomon() tries this one first */
+static Timer topologytimer = { 0, updatetopology };
+static Timer usagetimer = { 0, sampleusage };
+static long long lastsample;
+static char *usagebuf;
+static size_t usagebufsize;
+static Client **usagesort;            /* clients by pid and monitor, see sampleusage() */
+static size_t usagesortsize;
+static int containers;                /* tagcontainers and the shape extension is there */
+static int shapepending;
+static int cgroups;                   /* cgroupbase is set and usable */
+static Client *cgfocused;             /* runs at the focused weight */
+static XRectangle *shapebuf;
+static unsigned int shapebufsize;
 static Window root;
+static Window *restackbuf;
+static unsigned int restackbufsize;
+static Timer *timers;                       /* armed timers, soonest first */
+static int syncevent = -1, syncerror = -1;  /* XSync extension bases */
+#ifdef XRANDR
+static int rrevent = -1;                    /* XRandR event base */
+#endif /* XRANDR */
 
 /* configuration, allows nested code to access above variables */
 #include "config.h"
 
+/* built-in status modules, see statustick() */
+static StatusState statusstate[LENGTH(statusmodules)];
+static char statusval[LENGTH(statusmodules)][64];
+static Timer statustimers[LENGTH(statusmodules)];
+
+/* clients and monitors are carved from contiguous slabs */
+static Slab clientslab = { sizeof(Client), SLABCHUNK };
+static Slab coldslab = { sizeof(ClientCold), SLABCHUNK };
+static Slab monslab = { sizeof(Monitor), SLABCHUNK };
+
 /* compile-time check if all tags fit into an unsigned int bit array. */
-struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
+struct NumTags { char limitexceeded[LENGTH(tags) > MAXTAGS ? -1 : 1]; };
 
 /* function implementations */
 void
@@ -291,11 +529,11 @@ applyrules(Client *client)
     const char *class, *instance;
     unsigned int i;
     const Rule *r;
-    Monitor *m;
     XClassHint ch = { NULL, NULL };
 
     /* rule matching */
     client->isfloating = 0;
+    client->wireframe = 0;
     client->tags = 0;
     XGetClassHint(dpy, client->win, &ch);
     class    = ch.res_class ? ch.res_class : broken;
@@ -303,15 +541,15 @@ applyrules(Client *client)
 
     for (i = 0; i < LENGTH(rules); i++) {
         r = &rules[i];
-        if ((!r->title || strstr(client->name, r->title))
+        if ((!r->title || strstr(client->cold->name, r->title))
         && (!r->class || strstr(class, r->class))
         && (!r->instance || strstr(instance, r->instance)))
         {
             client->isfloating = r->isfloating;
+            client->wireframe = r->wireframe;
             client->tags |= r->tags;
-            for (m = monitor_start; m && m->num != r->monitor; m = m->next);
-            if (m)
-                client->mon = m;
+            if (r->monitor >= 0 && r->monitor < (int)nmons)
+                client->mon = monbynum[r->monitor];
         }
     }
     if (ch.res_class)
@@ -355,72 +593,138 @@ applysizehints(Client *client, int *x_pos, int *y_pos, int *width, int *height,
         *width = bar_height;
     if (resizehints || client->isfloating || !client->mon->lt[client->mon->sellt]->arrange) {
         /* see last two sentences in ICCCM 4.1.2.3 */
-        baseismin = client->basew == client->minw && client->baseh == client->minh;
+        baseismin = client->cold->basew == client->cold->minw && client->cold->baseh == client->cold->minh;
         if (!baseismin) { /* temporarily remove base dimensions */
-            *width -= client->basew;
-            *height -= client->baseh;
+            *width -= client->cold->basew;
+            *height -= client->cold->baseh;
         }
         /* adjust for aspect limits */
-        if (client->mina > 0 && client->maxa > 0) {
-            if (client->maxa < (float)*width / *height)
-                *width = *height * client->maxa + 0.5;
-            else if (client->mina < (float)*height / *width)
-                *height = *width * client->mina + 0.5;
+        if (client->cold->mina > 0 && client->cold->maxa > 0) {
+            if (client->cold->maxa < (float)*width / *height)
+                *width = *height * client->cold->maxa + 0.5;
+            else if (client->cold->mina < (float)*height / *width)
+                *height = *width * client->cold->mina + 0.5;
         }
         if (baseismin) { /* increment calculation requires this */
-            *width -= client->basew;
-            *height -= client->baseh;
+            *width -= client->cold->basew;
+            *height -= client->cold->baseh;
         }
         /* adjust for increment value */
-        if (client->incw)
-            *width -= *width % client->incw;
-        if (client->inch)
-            *height -= *height % client->inch;
+        if (client->cold->incw)
+            *width -= *width % client->cold->incw;
+        if (client->cold->inch)
+            *height -= *height % client->cold->inch;
         /* restore base dimensions */
-        *width = MAX(*width + client->basew, client->minw);
-        *height = MAX(*height + client->baseh, client->minh);
-        if (client->maxw)
-            *width = MIN(*width, client->maxw);
-        if (client->maxh)
-            *height = MIN(*height, client->maxh);
+        *width = MAX(*width + client->cold->basew, client->cold->minw);
+        *height = MAX(*height + client->cold->baseh, client->cold->minh);
+        if (client->cold->maxw)
+            *width = MIN(*width, client->cold->maxw);
+        if (client->cold->maxh)
+            *height = MIN(*height, client->cold->maxh);
     }
     return *x_pos != client->x_pos || *y_pos != client->y_pos || *width != client->width || *height != client->height;
 }
 
+void
+armtimer(Timer *timer, unsigned int ms)
+{
+    Timer **tp;
+
+    disarmtimer(timer);
+    timer->due = nowms() + ms;
+    for (tp = &timers; *tp && (*tp)->due <= timer->due; tp = &(*tp)->next);
+    timer->next = *tp;
+    *tp = timer;
+}
+
 void
 arrange(Monitor *monitor)
 {
-    if (monitor)
-        showhide(monitor->stack);
-    else for (monitor = monitor_start; monitor; monitor = monitor->next)
-        showhide(monitor->stack);
     if (monitor) {
+        monitor->dirty = 0;
+        showhide(monitor->vstack);
         arrangemon(monitor);
         restack(monitor);
-    } else for (monitor = monitor_start; monitor; monitor = monitor->next)
-        arrangemon(monitor);
+        return;
+    }
+    /* NULL means every monitor something happened to since its last arrange */
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        if (monitor->dirty)
+            showhide(monitor->vstack);
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        if (monitor->dirty) {
+            monitor->dirty = 0;
+            arrangemon(monitor);
+        }
 }
 
 void
 arrangemon(Monitor *monitor)
 {
     strncpy(monitor->ltsymbol, monitor->lt[monitor->sellt]->symbol, sizeof monitor->ltsymbol);
-    if (monitor->lt[monitor->sellt]->arrange)
+    if (monitor->lt[monitor->sellt]->arrange && !replayplan(monitor)) {
         monitor->lt[monitor->sellt]->arrange(monitor);
+        recordplan(monitor);
+    }
 }
 
 void
 attach(Client *client)
 {
-    client->next = client->mon->clients;
-    client->mon->clients = client;
+    Monitor *m = client->mon;
+
+    client->prev = NULL;
+    client->next = m->clients;
+    if (client->next)
+        client->next->prev = client;
+    m->clients = client;
+    m->dirty = 1;
+    counttags(client, +1);
+    if (ISVISIBLE(client)) {
+        client->vprev = NULL;
+        client->vnext = m->visible;
+        if (client->vnext)
+            client->vnext->vprev = client;
+        m->visible = client;
+        m->nvisible++;
+    }
+}
+
+/* links a visible client right behind another visible one */
+void
+attachafter(Client *client, Client *after)
+{
+    client->prev = after;
+    client->next = after->next;
+    if (client->next)
+        client->next->prev = client;
+    after->next = client;
+    counttags(client, +1);
+    client->vprev = after;
+    client->vnext = after->vnext;
+    if (client->vnext)
+        client->vnext->vprev = client;
+    after->vnext = client;
+    client->mon->nvisible++;
 }
 
 void
 attachstack(Client *client)
 {
-    client->snext = client->mon->stack;
-    client->mon->stack = client;
+    Monitor *m = client->mon;
+
+    client->sprev = NULL;
+    client->snext = m->stack;
+    if (client->snext)
+        client->snext->sprev = client;
+    m->stack = client;
+    if (ISVISIBLE(client)) {
+        client->vsprev = NULL;
+        client->vsnext = m->vstack;
+        if (client->vsnext)
+            client->vsnext->vsprev = client;
+        m->vstack = client;
+    }
 }
 
 static void
@@ -429,7 +733,7 @@ bstack(Monitor *monitor) {
     unsigned int i, number_of_clients;
     Client *client;
 
-    for (number_of_clients = 0, client = nexttiled(monitor->clients); client; client = nexttiled(client->next), number_of_clients++);
+    for (number_of_clients = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), number_of_clients++);
     if (number_of_clients == 0)
         return;
     if (number_of_clients > monitor->nmaster) {
@@ -441,7 +745,7 @@ bstack(Monitor *monitor) {
         tw = monitor->window_width;
         ty = monitor->window_y;
     }
-    for (i = monitor_x = 0, tx = monitor->window_x, client = nexttiled(monitor->clients); client; client = nexttiled(client->next), i++) {
+    for (i = monitor_x = 0, tx = monitor->window_x, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), i++) {
         if (i < monitor->nmaster) {
             width = (monitor->window_width - monitor_x) / (MIN(number_of_clients, monitor->nmaster) - i);
             resize(client, monitor->window_x + monitor_x, monitor->window_y, width - (2 * client->bw), monitor_height - (2 * client->bw), 0);
@@ -461,7 +765,7 @@ bstackhoriz(Monitor *monitor) {
     unsigned int i, number_of_clients;
     Client *client;
 
-    for (number_of_clients = 0, client = nexttiled(monitor->clients); client; client = nexttiled(client->next), number_of_clients++);
+    for (number_of_clients = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), number_of_clients++);
     if (number_of_clients == 0)
         return;
     if (number_of_clients > monitor->nmaster) {
@@ -472,7 +776,7 @@ bstackhoriz(Monitor *monitor) {
         th = monitor_height = monitor->window_height;
         ty = monitor->window_y;
     }
-    for (i = monitor_x = 0, tx = monitor->window_x, client = nexttiled(monitor->clients); client; client = nexttiled(client->next), i++) {
+    for (i = monitor_x = 0, tx = monitor->window_x, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), i++) {
         if (i < monitor->nmaster) {
             width = (monitor->window_width - monitor_x) / (MIN(number_of_clients, monitor->nmaster) - i);
             resize(client, monitor->window_x + monitor_x, monitor->window_y, width - (2 * client->bw), monitor_height - (2 * client->bw), 0);
@@ -485,13 +789,30 @@ bstackhoriz(Monitor *monitor) {
     }
 }
 
+/* binary search for the segment of the last drawn bar containing x */
+const BarSeg *
+barsegat(Monitor *monitor, int x)
+{
+    unsigned int lo = 0, hi = monitor->nbarsegs, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (monitor->barsegs[mid].x <= x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < monitor->nbarsegs ? &monitor->barsegs[lo] : NULL;
+}
+
 void
 buttonpress(XEvent *event)
 {
-    unsigned int i, x, click;
+    unsigned int i, click;
     Arg arg = {0};
     Client *client;
     Monitor *monitor;
+    const BarSeg *seg;
     XButtonPressedEvent *button_press_ev = &event->xbutton;
 
     click = ClkRootWin;
@@ -502,19 +823,13 @@ buttonpress(XEvent *event)
         focus(NULL);
     }
     if (button_press_ev->window == selected_monitor->barwin) {
-        i = x = 0;
-        do
-            x += TEXTW(tags[i]);
-        while (button_press_ev->x >= x && ++i < LENGTH(tags));
-        if (i < LENGTH(tags)) {
-            click = ClkTagBar;
-            arg.ui = 1 << i;
-        } else if (button_press_ev->x < x + blw)
-            click = ClkLtSymbol;
-        else if (button_press_ev->x > selected_monitor->window_width - TEXTW(stext))
-            click = ClkStatusText;
+        if (!(seg = barsegat(selected_monitor, button_press_ev->x)))
+            return;
+        click = seg->click;
+        if (click == ClkTagBar)
+            arg.ui = 1 << seg->arg;
         else
-            click = ClkWinTitle;
+            arg.i = seg->arg;
     } else if ((client = wintoclient(button_press_ev->window))) {
         focus(client);
         click = ClkClientWin;
@@ -522,7 +837,7 @@ buttonpress(XEvent *event)
     for (i = 0; i < LENGTH(buttons); i++)
         if (click == buttons[i].click && buttons[i].func && buttons[i].button == button_press_ev->button
         && CLEANMASK(buttons[i].mask) == CLEANMASK(button_press_ev->state))
-            buttons[i].func(click == ClkTagBar && buttons[i].arg.i == 0 ? &arg : &buttons[i].arg);
+            buttons[i].func((click == ClkTagBar || click == ClkStatusText) && buttons[i].arg.i == 0 ? &arg : &buttons[i].arg);
 }
 
 void
@@ -549,6 +864,7 @@ cleanup(void)
     for (m = monitor_start; m; m = m->next)
         while (m->stack)
             unmanage(m->stack, 0);
+    cg_cleanup();
     XUngrabKey(dpy, AnyKey, AnyModifier, root);
     while (monitor_start)
         cleanupmon(monitor_start);
@@ -560,15 +876,40 @@ cleanup(void)
         drw_clr_free(scheme[i].fg);
     }
     drw_free(drw);
+    free(restackbuf);
+    free(monbynum);
+    free(monbyx);
+    free(shapebuf);
+    free(usagebuf);
+    free(usagesort);
+    if (statusfd >= 0) {
+        close(statusfd);
+        close(statuswfd);
+    }
+    for (i = 0; i < LENGTH(ipcclients); i++)
+        if (ipcclients[i].fd >= 0)
+            ipcclose(&ipcclients[i]);
+    if (ipcfd >= 0) {
+        close(ipcfd);
+        unlink(ipcsocket);
+    }
+    for (i = 0; i < LENGTH(statusmodules); i++)
+        if (builtinstatus && statusstate[i].fd >= 0)
+            close(statusstate[i].fd);
+    slab_destroy(&clientslab);
+    slab_destroy(&coldslab);
+    slab_destroy(&monslab);
     XSync(dpy, False);
     XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
     XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
+    XDeleteProperty(dpy, root, dwmatom[DWMStats]);
 }
 
 void
 cleanupmon(Monitor *mon)
 {
     Monitor *monitor;
+    unsigned int i;
 
     if (mon == monitor_start)
         monitor_start = monitor_start->next;
@@ -578,7 +919,19 @@ cleanupmon(Monitor *mon)
     }
     XUnmapWindow(dpy, mon->barwin);
     XDestroyWindow(dpy, mon->barwin);
-    free(mon);
+    XDestroyWindow(dpy, mon->deskwin);
+    for (i = 0; i < LENGTH(tags); i++)
+        if (mon->tagwin[i])
+            XDestroyWindow(dpy, mon->tagwin[i]);
+    if (lasthit == mon)
+        lasthit = NULL;
+    free(mon->stackorder);
+    for (i = 0; i < LENGTH(mon->plans); i++) {
+        free(mon->plans[i].wins);
+        free(mon->plans[i].geom);
+    }
+    slab_free(&monslab, mon);
+    updatestats();
 }
 
 void
@@ -586,7 +939,7 @@ clearurgent(Client *client)
 {
     XWMHints *wmh;
 
-    client->isurgent = 0;
+    seturgent(client, 0);
     if (!(wmh = XGetWMHints(dpy, client->win)))
         return;
     wmh->flags &= ~XUrgencyHint;
@@ -610,11 +963,54 @@ clientmessage(XEvent *event)
         if (!ISVISIBLE(c)) {
             c->mon->seltags ^= 1;
             c->mon->tagset[c->mon->seltags] = c->tags;
+            updatevisible(c->mon);
         }
         pop(c);
     }
 }
 
+/* by pid, then by monitor */
+int
+cmppid(const void *a, const void *b)
+{
+    const Client *ca = *(Client *const *)a, *cb = *(Client *const *)b;
+
+    if (ca->cold->pid != cb->cold->pid)
+        return (ca->cold->pid > cb->cold->pid) - (ca->cold->pid < cb->cold->pid);
+    return (ca->mon->num > cb->mon->num) - (ca->mon->num < cb->mon->num);
+}
+
+/* joins the module values, only called when one of them changed */
+void
+composestatus(void)
+{
+    size_t i, len = 0;
+
+    stext[0] = '\0';
+    for (i = 0; builtinstatus && i < LENGTH(statusmodules) && len < sizeof stext; i++) {
+        if (!statusval[i][0])
+            continue;
+        len += snprintf(stext + len, sizeof stext - len, "%s%s", len ? statussep : "", statusval[i]);
+    }
+    for (i = 0; i < nstatussegs && len < sizeof stext; i++)
+        len += snprintf(stext + len, sizeof stext - len, "%s%s", len ? statussep : "", statussegs[i].text);
+}
+
+void
+compressmotion(XEvent *event)
+{
+    XEvent next;
+
+    /* skip to the newest of the motion events queued back to back */
+    while (XEventsQueued(dpy, QueuedAfterReading)) {
+        XPeekEvent(dpy, &next);
+        if (next.type != MotionNotify)
+            break;
+        XNextEvent(dpy, event);
+        trackpointer(event);
+    }
+}
+
 void
 configure(Client *client)
 {
@@ -637,24 +1033,41 @@ configure(Client *client)
 void
 configurenotify(XEvent *event)
 {
-    Monitor *monitor;
     XConfigureEvent *config_event = &event->xconfigure;
-    int dirty;
 
-    /* TODO: updategeom handling sucks, needs to be simplified */
+    /* one reconfiguration sends several of these, updatetopology() runs
+     * once they stop coming */
     if (config_event->window == root) {
-        dirty = (screen_width != config_event->width || sh != config_event->height);
         screen_width = config_event->width;
         sh = config_event->height;
-        if (updategeom() || dirty) {
-            drw_resize(drw, screen_width, bar_height);
-            updatebars();
-            for (monitor = monitor_start; monitor; monitor = monitor->next)
-                XMoveResizeWindow(dpy, monitor->barwin, monitor->window_x, monitor->bar_y, monitor->window_width, bar_height);
-            focus(NULL);
-            arrange(NULL);
-        }
+        armtimer(&topologytimer, TOPOLOGYDELAY);
+    } else if (!wintodesk(config_event->window) && (!config_event->above || wintodesk(config_event->above)))
+        lowerdesks(); /* something went below or between the desk windows */
+}
+
+/* keeps the per tag client and urgency counts of the client's monitor */
+void
+counttags(Client *client, int delta)
+{
+    Monitor *m = client->mon;
+    unsigned int i, occ = m->occ, urg = m->urg;
+
+    for (i = 0; i < LENGTH(tags); i++) {
+        if (!(client->tags & 1 << i))
+            continue;
+        if ((m->tagclients[i] += delta))
+            m->occ |= 1 << i;
+        else
+            m->occ &= ~(1 << i);
+        if (!client->isurgent)
+            continue;
+        if ((m->tagurgent[i] += delta))
+            m->urg |= 1 << i;
+        else
+            m->urg &= ~(1 << i);
     }
+    if (m->occ != occ || m->urg != urg)
+        occchanged = 1;
 }
 
 void
@@ -666,24 +1079,26 @@ configurerequest(XEvent *event)
     XWindowChanges window_changes;
 
     if ((client = wintoclient(config_request->window))) {
-        if (config_request->value_mask & CWBorderWidth)
+        if (config_request->value_mask & CWBorderWidth) {
             client->bw = config_request->border_width;
+            invalidateplans(client->mon);
+        }
         else if (client->isfloating || !selected_monitor->lt[selected_monitor->sellt]->arrange) {
             monitor = client->mon;
             if (config_request->value_mask & CWX) {
-                client->oldx = client->x_pos;
+                client->cold->oldx = client->x_pos;
                 client->x_pos = monitor->mon_x + config_request->x;
             }
             if (config_request->value_mask & CWY) {
-                client->oldy = client->y_pos;
+                client->cold->oldy = client->y_pos;
                 client->y_pos = monitor->mon_y + config_request->y;
             }
             if (config_request->value_mask & CWWidth) {
-                client->oldw = client->width;
+                client->cold->oldw = client->width;
                 client->width = config_request->width;
             }
             if (config_request->value_mask & CWHeight) {
-                client->oldh = client->height;
+                client->cold->oldh = client->height;
                 client->height = config_request->height;
             }
             if ((client->x_pos + client->width) > monitor->mon_x + monitor->mon_width && client->isfloating)
@@ -692,8 +1107,11 @@ configurerequest(XEvent *event)
                 client->y_pos = monitor->mon_y + (monitor->mon_height / 2 - HEIGHT(client) / 2); /* center in y direction */
             if ((config_request->value_mask & (CWX|CWY)) && !(config_request->value_mask & (CWWidth|CWHeight)))
                 configure(client);
-            if (ISVISIBLE(client))
-                XMoveResizeWindow(dpy, client->win, client->x_pos, client->y_pos, client->width, client->height);
+            if (ISVISIBLE(client)) {
+                XMoveResizeWindow(dpy, client->win, WINX(client), WINY(client), client->width, client->height);
+                if (client->cold->container)
+                    markshape(client->cold->container);
+            }
         } else
             configure(client);
     } else {
@@ -705,16 +1123,31 @@ configurerequest(XEvent *event)
         window_changes.sibling = config_request->above;
         window_changes.stack_mode = config_request->detail;
         XConfigureWindow(dpy, config_request->window, config_request->value_mask, &window_changes);
+        if (config_request->value_mask & CWStackMode)
+            lowerdesks();
     }
     XSync(dpy, False);
 }
 
+Client *
+createclient(void)
+{
+    Client *client;
+
+    client = slab_alloc(&clientslab);
+    client->cold = slab_alloc(&coldslab);
+    client->cold->synctimer.fire = synctimeout;
+    client->cold->synctimer.arg = client;
+    client->cold->statfd = client->cold->statmfd = -1;
+    return client;
+}
+
 Monitor *
 createmon(void)
 {
     Monitor *monitor;
 
-    monitor = ecalloc(1, sizeof(Monitor));
+    monitor = slab_alloc(&monslab);
     monitor->tagset[0] = monitor->tagset[1] = 1;
     monitor->mfact = mfact;
     monitor->nmaster = nmaster;
@@ -723,6 +1156,8 @@ createmon(void)
     monitor->lt[0] = &layouts[0];
     monitor->lt[1] = &layouts[1 % LENGTH(layouts)];
     strncpy(monitor->ltsymbol, layouts[0].symbol, sizeof monitor->ltsymbol);
+    monitor->refresh = 60;
+    updatestats();
     return monitor;
 }
 
@@ -739,56 +1174,121 @@ destroynotify(XEvent *event)
 void
 detach(Client *client)
 {
-    Client **tc;
+    Monitor *m = client->mon;
 
-    for (tc = &client->mon->clients; *tc && *tc != client; tc = &(*tc)->next);
-    *tc = client->next;
+    if (client->prev)
+        client->prev->next = client->next;
+    else
+        m->clients = client->next;
+    if (client->next)
+        client->next->prev = client->prev;
+    m->dirty = 1;
+    counttags(client, -1);
+    if (client->vprev || client == m->visible) {
+        if (client->vprev)
+            client->vprev->vnext = client->vnext;
+        else
+            m->visible = client->vnext;
+        if (client->vnext)
+            client->vnext->vprev = client->vprev;
+        client->vprev = client->vnext = NULL;
+        m->nvisible--;
+    }
 }
 
 void
 detachstack(Client *client)
 {
-    Client **tc, *t;
-
-    for (tc = &client->mon->stack; *tc && *tc != client; tc = &(*tc)->snext);
-    *tc = client->snext;
+    Monitor *m = client->mon;
 
-    if (client == client->mon->selected_client) {
-        for (t = client->mon->stack; t && !ISVISIBLE(t); t = t->snext);
-        client->mon->selected_client = t;
+    if (client->sprev)
+        client->sprev->snext = client->snext;
+    else
+        m->stack = client->snext;
+    if (client->snext)
+        client->snext->sprev = client->sprev;
+    if (client->vsprev || client == m->vstack) {
+        if (client->vsprev)
+            client->vsprev->vsnext = client->vsnext;
+        else
+            m->vstack = client->vsnext;
+        if (client->vsnext)
+            client->vsnext->vsprev = client->vsprev;
+        client->vsprev = client->vsnext = NULL;
     }
+
+    if (client == m->selected_client)
+        m->selected_client = m->vstack;
 }
 
 Monitor *
 dirtomon(int dir)
 {
-    Monitor *monitor = NULL;
+    /* unknown numbers pick the last monitor */
+    return monbynum[dir >= 0 && dir < (int)nmons ? dir : nmons - 1];
+}
+
+void
+disarmtimer(Timer *timer)
+{
+    Timer **tp;
 
-    for (monitor = monitor_start; monitor->next; monitor = monitor->next)
-        if (dir == monitor->num)
-            return monitor;
+    if (!timer->due)
+        return;
+    for (tp = &timers; *tp != timer; tp = &(*tp)->next);
+    *tp = timer->next;
+    timer->due = 0;
+}
 
-    return monitor;
+void
+dispatch(XEvent *event)
+{
+    trackpointer(event);
+    if (syncevent >= 0 && event->type == syncevent + XSyncAlarmNotify)
+        syncalarm(event);
+#ifdef XRANDR
+    else if (rrevent >= 0 && (event->type == rrevent + RRScreenChangeNotify || event->type == rrevent + RRNotify)) {
+        XRRUpdateConfiguration(event);
+        armtimer(&topologytimer, TOPOLOGYDELAY);
+    }
+#endif /* XRANDR */
+    else if (event->type < LASTEvent && handler[event->type])
+        handler[event->type](event); /* call handler */
+}
+
+/* XMaskEvent() for the move and resize loops, timers and sync acks keep
+ * running while the pointer is grabbed */
+void
+dragevent(XEvent *event)
+{
+    struct pollfd pfd;
+    int timeout;
+
+    pfd.fd = ConnectionNumber(dpy);
+    pfd.events = POLLIN;
+    for (;;) {
+        timeout = runtimers();
+        if (shapepending)
+            flushshapes();
+        if (XCheckMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, event))
+            return;
+        if (syncevent >= 0 && XCheckTypedEvent(dpy, syncevent + XSyncAlarmNotify, event))
+            syncalarm(event);
+        else if (poll(&pfd, 1, timeout) == -1 && errno != EINTR)
+            die("poll:");
+    }
 }
 
 void
 drawbar(Monitor *monitor)
 {
-    int x, xx, width, dx;
-    unsigned int i, occ = 0, urg = 0;
-    Client *client;
+    int x, xx, width, dx, n, spans[MAXSTATUSSPANS];
+    unsigned int i, occ = monitor->occ, urg = monitor->urg;
+    BarSeg *seg = monitor->barsegs;
 
     /* text height /4 WHY ?? */
     dx = (drw->fonts[0]->ascent + drw->fonts[0]->descent + 2) / 4;
 
-    /* go through each client and set occ to contain tags && urg if urgent*/
-    for (client = monitor->clients; client; client = client->next)
-    {
-        occ |= client->tags;
-        if (client->isurgent)
-            urg |= client->tags;
-    }
-
     x = 0;
 
     /* draws the actual bar */
@@ -809,10 +1309,11 @@ drawbar(Monitor *monitor)
 
         /*add the width of each tag to x */
         x += width;
+        *seg++ = (BarSeg){ x, ClkTagBar, i };
     }
 
     /* set width and bar to to layout symbol  */
-    width = blw = TEXTW(monitor->ltsymbol);
+    width = TEXTW(monitor->ltsymbol);
 
     /* set scheme to normal */
     drw_setscheme(drw, &scheme[0]);
@@ -822,6 +1323,18 @@ drawbar(Monitor *monitor)
 
     /* add width of layout symbol to x */
     x += width;
+    *seg++ = (BarSeg){ x, ClkLtSymbol, 0 };
+
+    /* cpu and memory of the focused client and the view */
+    if (showusage && usageinterval) {
+        char usage[64];
+
+        usagetext(monitor, usage, sizeof usage);
+        width = TEXTW(usage);
+        drw_text(drw, x, 0, width, bar_height, usage, 0);
+        x += width;
+        *seg++ = (BarSeg){ x, ClkUsage, 0 };
+    }
 
     /* set xx to the total width of all text on the bar */
     xx = x;
@@ -834,6 +1347,7 @@ drawbar(Monitor *monitor)
 
         /* set x to differnce between the window and the stext */
         x = monitor->window_width - width;
+        monitor->statusw = x < xx ? -1 : width;
 
         /* if there is more text than free space */
         if (x < xx)
@@ -842,8 +1356,15 @@ drawbar(Monitor *monitor)
             /* set width to left over space  */
             width = monitor->window_width - xx;
         }
-        /*  */
-        drw_colored_text(drw, scheme, NUMCOLORS, x, 0, width, bar_height, stext);
+        /* the title takes what is left between layout symbol and status */
+        if (x > xx)
+            *seg++ = (BarSeg){ x, ClkWinTitle, 0 };
+        n = drw_colored_text(drw, scheme, NUMCOLORS, x, 0, width, bar_height, stext, spans, MAXSTATUSSPANS);
+        for (i = 0; i < n; i++)
+            if (spans[i] > (seg - 1)->x && spans[i] < monitor->window_width)
+                *seg++ = (BarSeg){ spans[i], ClkStatusText, i };
+        *seg++ = (BarSeg){ monitor->window_width, ClkStatusText, n };
+        monitor->nbarsegs = seg - monitor->barsegs;
 //    } else
 //        x = monitor->window_width;
 
@@ -854,7 +1375,7 @@ drawbar(Monitor *monitor)
         if (monitor->selected_client)
         {
             drw_setscheme(drw, &scheme[monitor == selected_monitor ? 1 : 0]);
-            drw_text(drw, x, 0, width, bar_height, monitor->selected_client->name, 0);
+            drw_text(drw, x, 0, width, bar_height, monitor->selected_client->cold->name, 0);
             drw_rect(drw, x + 1, 1, dx, dx, monitor->selected_client->isfixed, monitor->selected_client->isfloating, 0);
         } else {
             drw_setscheme(drw, &scheme[0]);
@@ -873,6 +1394,39 @@ drawbars(void)
         drawbar(monitor);
 }
 
+/* repaints only the status when it kept its width, the rest of the bar
+ * cannot have moved then */
+void
+drawstatus(Monitor *monitor)
+{
+    BarSeg *seg;
+    int x, width, n, spans[MAXSTATUSSPANS];
+    int i;
+
+    width = drw_get_width(drw, NUMCOLORS, stext);
+    if (width != monitor->statusw) {
+        drawbar(monitor);
+        return;
+    }
+    x = monitor->window_width - width;
+    for (seg = monitor->barsegs; seg < monitor->barsegs + monitor->nbarsegs && seg->click != ClkStatusText; seg++);
+    drw_setscheme(drw, &scheme[0]);
+    n = drw_colored_text(drw, scheme, NUMCOLORS, x, 0, width, bar_height, stext, spans, MAXSTATUSSPANS);
+    for (i = 0; i < n; i++)
+        if (spans[i] > (seg - 1)->x && spans[i] < monitor->window_width)
+            *seg++ = (BarSeg){ spans[i], ClkStatusText, i };
+    *seg++ = (BarSeg){ monitor->window_width, ClkStatusText, n };
+    monitor->nbarsegs = seg - monitor->barsegs;
+    drw_map(drw, monitor->barwin, x, 0, width, bar_height);
+}
+
+void
+drawoutline(GC gc, Client *client, int x_pos, int y_pos, int width, int height)
+{
+    /* xor, so drawing the same frame again erases it */
+    XDrawRectangle(dpy, root, gc, x_pos, y_pos, width + 2 * client->bw - 1, height + 2 * client->bw - 1);
+}
+
 void
 enternotify(XEvent *event)
 {
@@ -880,6 +1434,8 @@ enternotify(XEvent *event)
     Monitor *monitor;
     XCrossingEvent *crossing_event = &event->xcrossing;
 
+    if ((long)(crossing_event->serial - enterserial) < 0)
+        return;
     if ((crossing_event->mode != NotifyNormal || crossing_event->detail == NotifyInferior) && crossing_event->window != root)
         return;
     client = wintoclient(crossing_event->window);
@@ -902,11 +1458,42 @@ expose(XEvent *event)
         drawbar(monitor);
 }
 
+/* a container is shaped to the union of its clients so that it only
+ * covers what it shows, other containers and root clients stay visible */
+void
+flushshapes(void)
+{
+    Monitor *m;
+    Client *c;
+    unsigned int i, n;
+
+    for (m = monitor_start; m; m = m->next)
+        for (i = 0; m->shapetags; i++) {
+            if (!(m->shapetags & 1 << i))
+                continue;
+            m->shapetags &= ~(1 << i);
+            if (!m->tagwin[i])
+                continue;
+            if (m->tagclients[i] > shapebufsize)
+                shapebuf = erealloc(shapebuf, (shapebufsize = m->tagclients[i]) * sizeof(XRectangle));
+            for (n = 0, c = m->clients; c; c = c->next)
+                if (c->cold->container == m->tagwin[i] && c->isshown) {
+                    shapebuf[n].x = c->x_pos - m->mon_x;
+                    shapebuf[n].y = c->y_pos - m->mon_y;
+                    shapebuf[n].width = c->width + 2 * MAX(c->bw, c->cold->cfgbw);
+                    shapebuf[n].height = c->height + 2 * MAX(c->bw, c->cold->cfgbw);
+                    n++;
+                }
+            XShapeCombineRectangles(dpy, m->tagwin[i], ShapeBounding, 0, 0, shapebuf, n, ShapeSet, Unsorted);
+        }
+    shapepending = 0;
+}
+
 void
 focus(Client *client)
 {
     if (!client || !ISVISIBLE(client))
-        for (client = selected_monitor->stack; client && !ISVISIBLE(client); client = client->snext);
+        client = selected_monitor->vstack;
     /* was if (selmon->sel) */
     if (selected_monitor->selected_client && selected_monitor->selected_client != client)
         unfocus(selected_monitor->selected_client, 0);
@@ -915,8 +1502,10 @@ focus(Client *client)
             selected_monitor = client->mon;
         if (client->isurgent)
             clearurgent(client);
-        detachstack(client);
-        attachstack(client);
+        if (client != client->mon->stack) {
+            detachstack(client);
+            attachstack(client);
+        }
         grabbuttons(client, 1);
         XSetWindowBorder(dpy, client->win, scheme[1].border->pix);
         setfocus(client);
@@ -925,6 +1514,16 @@ focus(Client *client)
         XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
     }
     selected_monitor->selected_client = client;
+    ipcnotifyfocus();
+    if (cgroups && client != cgfocused) {
+        Client *prev = cgfocused;
+
+        cgfocused = client;
+        if (prev)
+            updatecgroup(prev);
+        if (client)
+            updatecgroup(client);
+    }
     drawbars();
 }
 
@@ -962,14 +1561,28 @@ focusstack(const Arg *arg)
 
     if(i < 0)
             return;
-    for(p = NULL, client = selected_monitor->clients; client && (i || !ISVISIBLE(client));
-        i -= ISVISIBLE(client) ? 1 : 0, p = client, client = client->next);
+    for(p = NULL, client = selected_monitor->visible; client && i; i--, p = client, client = client->vnext);
     focus(client ? client : p);
     restack(selected_monitor);
 
 
 }
 
+void
+freeclient(Client *client)
+{
+    disarmtimer(&client->cold->synctimer);
+    if (client->cold->syncalarm != None)
+        XSyncDestroyAlarm(dpy, client->cold->syncalarm);
+    if (client->cold->statfd >= 0)
+        close(client->cold->statfd);
+    if (client->cold->statmfd >= 0)
+        close(client->cold->statmfd);
+    free(client->cold->netstate);
+    slab_free(&coldslab, client->cold);
+    slab_free(&clientslab, client);
+}
+
 Atom
 getatomprop(Client *client, Atom prop)
 {
@@ -986,6 +1599,29 @@ getatomprop(Client *client, Atom prop)
     return atom;
 }
 
+/* _NET_WM_PID only names a local process when WM_CLIENT_MACHINE is this host */
+pid_t
+getclientpid(Client *client)
+{
+    int di;
+    unsigned long dl;
+    unsigned char *p = NULL;
+    Atom da;
+    pid_t pid = 0;
+    char host[256], machine[256];
+
+    if (gethostname(host, sizeof host) < 0
+    || !gettextprop(client->win, XA_WM_CLIENT_MACHINE, machine, sizeof machine)
+    || strncmp(host, machine, sizeof host))
+        return 0;
+    if (XGetWindowProperty(dpy, client->win, netatom[NetWMPid], 0L, 1L, False, XA_CARDINAL,
+                          &da, &di, &dl, &dl, &p) == Success && p) {
+        pid = *(long *)p;
+        XFree(p);
+    }
+    return pid > 1 && pid != getpid() ? pid : 0;
+}
+
 int
 getrootptr(int *x_pos, int *y_pos)
 {
@@ -1043,7 +1679,6 @@ gettextprop(Window window, Atom atom, char *text, unsigned int size)
 void
 grabbuttons(Client *client, int focused)
 {
-    updatenumlockmask();
     {
         unsigned int i, j;
         unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
@@ -1080,75 +1715,357 @@ grabkeys(void)
     }
 }
 
-#ifdef XINERAMA
-static int
-isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
+void
+ipcaccept(void)
 {
-    while (n--)
-        if (unique[n].x_org == info->x_org && unique[n].y_org == info->y_org
-        && unique[n].width == info->width && unique[n].height == info->height)
-            return 0;
-    return 1;
+    unsigned int i;
+    int fd;
+
+    if ((fd = accept(ipcfd, NULL, NULL)) < 0)
+        return;
+    for (i = 0; i < LENGTH(ipcclients) && ipcclients[i].fd >= 0; i++);
+    if (i == LENGTH(ipcclients)) {
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    ipcclients[i].fd = fd;
 }
-#endif /* XINERAMA */
 
 void
-keypress(XEvent *event)
+ipcclose(IpcClient *ipc)
+{
+    close(ipc->fd);
+    free(ipc->out);
+    memset(ipc, 0, sizeof *ipc);
+    ipc->fd = -1;
+}
+
+/* runs "name argument" through ipccommands, or takes a subscription */
+void
+ipccommand(IpcClient *ipc, char *line)
+{
+    const char *shcmd[] = { "/bin/sh", "-c", NULL, NULL };
+    char *arg, *tok;
+    unsigned int i, events;
+    Arg a = {0};
+    int n;
+
+    if ((arg = strchr(line, ' ')))
+        *arg++ = '\0';
+    else
+        arg = "";
+    if (!strcmp(line, "subscribe")) {
+        for (events = 0, tok = strtok(arg, " "); tok; tok = strtok(NULL, " ")) {
+            for (i = 0; i < LENGTH(ipcevents) && strcmp(ipcevents[i], tok); i++);
+            if (i == LENGTH(ipcevents)) {
+                ipcreply(ipc, "error unknown event");
+                return;
+            }
+            events |= 1 << i;
+        }
+        ipc->events |= events; /* all or nothing */
+        ipcreply(ipc, "ok");
+        return;
+    }
+    for (i = 0; i < LENGTH(ipccommands) && strcmp(ipccommands[i].name, line); i++);
+    if (i == LENGTH(ipccommands)) {
+        ipcreply(ipc, "error unknown command");
+        return;
+    }
+    switch (ipccommands[i].argtype) {
+    case IpcInt:
+        a.i = atoi(arg);
+        break;
+    case IpcUint:
+        a.ui = strtoul(arg, NULL, 0);
+        break;
+    case IpcFloat:
+        a.f = atof(arg);
+        break;
+    case IpcStack: /* "+n" and "-n" move relative, "prev" is the previous selection */
+        a.i = !strcmp(arg, "prev") ? PREVSEL : (*arg == '+' || *arg == '-') ? INC(atoi(arg)) : atoi(arg);
+        break;
+    case IpcLayout:
+        if (*arg) {
+            if ((n = atoi(arg)) < 0 || n >= (int)LENGTH(layouts)) {
+                ipcreply(ipc, "error no such layout");
+                return;
+            }
+            a.v = &layouts[n];
+        }
+        break;
+    case IpcCmd:
+        shcmd[2] = arg;
+        a.v = shcmd;
+        break;
+    }
+    ipccommands[i].func(&a);
+    if (ipc->fd >= 0)
+        ipcreply(ipc, "ok");
+}
+
+/* sends a line to every subscriber of the event */
+void
+ipcevent(int event, const char *fmt, ...)
 {
+    char buf[256];
+    va_list ap;
     unsigned int i;
-    KeySym keysym;
-    XKeyEvent *key_event;
+    int len;
 
-    key_event = &event->xkey;
-    keysym = XKeycodeToKeysym(dpy, (KeyCode)key_event->keycode, 0);
-    for (i = 0; i < LENGTH(keys); i++)
-        if (keysym == keys[i].keysym
-        && CLEANMASK(keys[i].mod) == CLEANMASK(key_event->state)
-        && keys[i].func)
-            keys[i].func(&(keys[i].arg));
+    if (ipcfd < 0)
+        return;
+    va_start(ap, fmt);
+    len = vsnprintf(buf, sizeof buf, fmt, ap);
+    va_end(ap);
+    if (len < 0 || len >= (int)sizeof buf)
+        return;
+    for (i = 0; i < LENGTH(ipcclients); i++)
+        if (ipcclients[i].fd >= 0 && ipcclients[i].events & 1 << event)
+            ipcsend(&ipcclients[i], buf, len);
 }
 
 void
-killclient(const Arg *arg)
+ipcflush(IpcClient *ipc)
 {
-    if (!selected_monitor->selected_client)
+    ssize_t n;
+
+    if ((n = send(ipc->fd, ipc->out, ipc->outlen, MSG_NOSIGNAL)) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            ipcclose(ipc);
         return;
-    if (!sendevent(selected_monitor->selected_client, wmatom[WMDelete])) {
-        XGrabServer(dpy);
-        XSetErrorHandler(xerrordummy);
-        XSetCloseDownMode(dpy, DestroyAll);
-        XKillClient(dpy, selected_monitor->selected_client->win);
-        XSync(dpy, False);
-        XSetErrorHandler(xerror);
-        XUngrabServer(dpy);
     }
+    ipc->outlen -= n;
+    memmove(ipc->out, ipc->out + n, ipc->outlen);
 }
 
 void
-manage(Window window, XWindowAttributes *window_attributes)
+ipcio(IpcClient *ipc, short revents)
 {
-    Client *client, *t = NULL;
-    Window trans = None;
-    XWindowChanges window_changes;
+    char *line, *end;
+    ssize_t n;
 
-    client = ecalloc(1, sizeof(Client));
-    client->win = window;
-    updatetitle(client);
-    if (XGetTransientForHint(dpy, window, &trans) && (t = wintoclient(trans))) {
-        client->mon = t->mon;
-        client->tags = t->tags;
-    } else {
-        client->mon = selected_monitor;
-        applyrules(client);
+    if (revents & POLLOUT)
+        ipcflush(ipc);
+    if (ipc->fd < 0 || !(revents & (POLLIN|POLLHUP|POLLERR)))
+        return;
+    if ((n = read(ipc->fd, ipc->in + ipc->inlen, sizeof ipc->in - 1 - ipc->inlen)) <= 0) {
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            ipcclose(ipc);
+        return;
     }
-    /* geometry */
-    client->x_pos = client->oldx = window_attributes->x;
-    client->y_pos = client->oldy = window_attributes->y;
-    client->width = client->oldw = window_attributes->width;
-    client->height = client->oldh = window_attributes->height;
-    client->oldbw = window_attributes->border_width;
-
-    if (client->x_pos + WIDTH(client) > client->mon->mon_x + client->mon->mon_width)
+    ipc->inlen += n;
+    ipc->in[ipc->inlen] = '\0';
+    for (line = ipc->in; (end = strchr(line, '\n')); line = end + 1) {
+        *end = '\0';
+        ipccommand(ipc, line);
+        if (ipc->fd < 0) /* dropped while the command ran */
+            return;
+    }
+    ipc->inlen -= line - ipc->in;
+    memmove(ipc->in, line, ipc->inlen);
+    if (ipc->inlen == sizeof ipc->in - 1)
+        ipcclose(ipc); /* a line that long is no command */
+}
+
+void
+ipclisten(void)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    mode_t mask;
+
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(ipcsocket) >= sizeof addr.sun_path) {
+        fprintf(stderr, "dwm: socket path too long: %s\n", ipcsocket);
+        return;
+    }
+    strcpy(addr.sun_path, ipcsocket);
+    /* only a stale socket of an earlier run is removed, nothing else */
+    if (!lstat(ipcsocket, &st)) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "dwm: %s exists and is no socket\n", ipcsocket);
+            return;
+        }
+        unlink(ipcsocket);
+    }
+    /* spawn runs anything, only our user may connect */
+    mask = umask(077);
+    if ((ipcfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+    || bind(ipcfd, (struct sockaddr *)&addr, sizeof addr) < 0
+    || listen(ipcfd, LENGTH(ipcclients)) < 0) {
+        fprintf(stderr, "dwm: cannot listen on %s\n", ipcsocket);
+        if (ipcfd >= 0)
+            close(ipcfd);
+        ipcfd = -1;
+    }
+    umask(mask);
+    if (ipcfd < 0)
+        return;
+    fcntl(ipcfd, F_SETFL, O_NONBLOCK);
+    fcntl(ipcfd, F_SETFD, FD_CLOEXEC);
+}
+
+/* focus and monitor events go out only when they changed */
+void
+ipcnotifyfocus(void)
+{
+    static Window lastwin;
+    static int lastmon = -1;
+    Window win = selected_monitor->selected_client ? selected_monitor->selected_client->win : None;
+
+    if (win != lastwin)
+        ipcevent(IpcEvFocus, "focus 0x%lx\n", (lastwin = win));
+    if (selected_monitor->num != lastmon)
+        ipcevent(IpcEvMonitor, "monitor %d\n", (lastmon = selected_monitor->num));
+}
+
+/* run() calls this once the handler is done, retagging is a counttags()
+ * pair and the state between the two is never announced */
+void
+ipcnotifyocc(void)
+{
+    Monitor *monitor;
+
+    occchanged = 0;
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        if (monitor->occ != monitor->ipcocc || monitor->urg != monitor->ipcurg)
+            ipcnotifytags(monitor);
+}
+
+void
+ipcnotifytags(Monitor *monitor)
+{
+    monitor->ipcocc = monitor->occ;
+    monitor->ipcurg = monitor->urg;
+    ipcevent(IpcEvTags, "tags %d %u %u %u\n", monitor->num, monitor->tagset[monitor->seltags], monitor->occ, monitor->urg);
+}
+
+void
+ipcreply(IpcClient *ipc, const char *msg)
+{
+    char buf[64];
+    int len;
+
+    len = snprintf(buf, sizeof buf, "%s\n", msg);
+    ipcsend(ipc, buf, MIN(len, (int)sizeof buf - 1));
+}
+
+/* never blocks, a subscriber that stops reading is dropped */
+void
+ipcsend(IpcClient *ipc, const char *text, size_t len)
+{
+    ssize_t n = 0;
+
+    if (!ipc->outlen && (n = send(ipc->fd, text, len, MSG_NOSIGNAL)) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ipcclose(ipc);
+            return;
+        }
+        n = 0;
+    }
+    if ((size_t)n == len)
+        return;
+    if (ipc->outlen + len - n > IPCOUTMAX) {
+        ipcclose(ipc);
+        return;
+    }
+    ipc->out = erealloc(ipc->out, ipc->outlen + len - n);
+    memcpy(ipc->out + ipc->outlen, text + n, len - n);
+    ipc->outlen += len - n;
+}
+
+#ifdef XINERAMA
+static int
+isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
+{
+    while (n--)
+        if (unique[n].x_org == info->x_org && unique[n].y_org == info->y_org
+        && unique[n].width == info->width && unique[n].height == info->height)
+            return 0;
+    return 1;
+}
+#endif /* XINERAMA */
+
+void
+invalidateplans(Monitor *monitor)
+{
+    unsigned int i;
+
+    for (i = 0; i < LENGTH(monitor->plans); i++)
+        monitor->plans[i].lt = NULL;
+}
+
+void
+keypress(XEvent *event)
+{
+    unsigned int i;
+    KeySym keysym;
+    XKeyEvent *key_event;
+
+    key_event = &event->xkey;
+    keysym = XKeycodeToKeysym(dpy, (KeyCode)key_event->keycode, 0);
+    for (i = 0; i < LENGTH(keys); i++)
+        if (keysym == keys[i].keysym
+        && CLEANMASK(keys[i].mod) == CLEANMASK(key_event->state)
+        && keys[i].func)
+            keys[i].func(&(keys[i].arg));
+}
+
+void
+killclient(const Arg *arg)
+{
+    if (!selected_monitor->selected_client)
+        return;
+    if (!sendevent(selected_monitor->selected_client, WMDelete)) {
+        XGrabServer(dpy);
+        XSetErrorHandler(xerrordummy);
+        XSetCloseDownMode(dpy, DestroyAll);
+        XKillClient(dpy, selected_monitor->selected_client->win);
+        XSync(dpy, False);
+        XSetErrorHandler(xerror);
+        XUngrabServer(dpy);
+    }
+}
+
+/* keeps nothing below the desk windows, whatever swallows their input */
+void
+lowerdesks(void)
+{
+    Monitor *monitor;
+
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        XLowerWindow(dpy, monitor->deskwin);
+}
+
+void
+manage(Window window, XWindowAttributes *window_attributes)
+{
+    Client *client, *t = NULL;
+    Window trans = None;
+    XWindowChanges window_changes;
+
+    client = createclient();
+    client->win = window;
+    updatetitle(client);
+    if (XGetTransientForHint(dpy, window, &trans) && (t = wintoclient(trans))) {
+        client->mon = t->mon;
+        client->tags = t->tags;
+    } else {
+        client->mon = selected_monitor;
+        applyrules(client);
+    }
+    /* geometry */
+    client->x_pos = client->cold->oldx = window_attributes->x;
+    client->y_pos = client->cold->oldy = window_attributes->y;
+    client->width = client->cold->oldw = window_attributes->width;
+    client->height = client->cold->oldh = window_attributes->height;
+    client->cold->oldbw = window_attributes->border_width;
+
+    if (client->x_pos + WIDTH(client) > client->mon->mon_x + client->mon->mon_width)
         client->x_pos = client->mon->mon_x + client->mon->mon_width - WIDTH(client);
     if (client->y_pos + HEIGHT(client) > client->mon->mon_y + client->mon->mon_height)
         client->y_pos = client->mon->mon_y + client->mon->mon_height - HEIGHT(client);
@@ -1164,25 +2081,58 @@ manage(Window window, XWindowAttributes *window_attributes)
     configure(client); /* propagates border_width, if size doesn't change */
     updatewindowtype(client);
     updatesizehints(client);
-    updatewmhints(client);
+    updateprotocols(client);
+    client->cold->pid = getclientpid(client);
     XSelectInput(dpy, window, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
     grabbuttons(client, 0);
     if (!client->isfloating)
-        client->isfloating = client->oldstate = trans != None || client->isfixed;
+        client->isfloating = client->cold->oldstate = trans != None || client->isfixed;
     if (client->isfloating)
         XRaiseWindow(dpy, client->win);
+    client->mon->nstackorder = 0; /* the new window is mapped on top */
     attach(client);
     attachstack(client);
+    updatewmhints(client);
     XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
                     (unsigned char *) &(client->win), 1);
     XMoveResizeWindow(dpy, client->win, client->x_pos + 2 * screen_width, client->y_pos, client->width, client->height); /* some windows require this */
-    setclientstate(client, NormalState);
+    updatecontainer(client, window_attributes->map_state == IsViewable);
+    if (hiddenstate && !ISVISIBLE(client))
+        sethidden(client, 1); /* managed straight onto a hidden tag */
+    else
+        setclientstate(client, NormalState);
     if (client->mon == selected_monitor)
         unfocus(selected_monitor->selected_client, 0);
     client->mon->selected_client = client;
     arrange(client->mon);
     XMapWindow(dpy, client->win);
     focus(NULL);
+    updatecgroup(client);
+    updatestats();
+    ipcevent(IpcEvClient, "client add 0x%lx\n", client->win);
+}
+
+void
+markshape(Window container)
+{
+    Monitor *m;
+    unsigned int i;
+
+    for (m = monitor_start; m; m = m->next)
+        for (i = 0; i < LENGTH(tags); i++)
+            if (m->tagwin[i] == container) {
+                m->shapetags |= 1 << i;
+                shapepending = 1;
+                return;
+            }
+}
+
+void
+mapnotify(XEvent *event)
+{
+    /* an override-redirect window may be mapped below the desk windows */
+    if (event->xmap.override_redirect && !wintodesk(event->xmap.window))
+        lowerdesks();
 }
 
 void
@@ -1191,8 +2141,8 @@ mappingnotify(XEvent *event)
     XMappingEvent *mapping_event = &event->xmapping;
 
     XRefreshKeyboardMapping(mapping_event);
-    if (mapping_event->request == MappingKeyboard)
-        grabkeys();
+    if (mapping_event->request == MappingKeyboard || mapping_event->request == MappingModifier)
+        grabkeys(); /* also refreshes numlockmask */
 }
 
 void
@@ -1212,71 +2162,81 @@ maprequest(XEvent *event)
 void
 monocle(Monitor *monitor)
 {
-    unsigned int n = 0;
     Client *client;
 
-    for (client = monitor->clients; client; client = client->next)
-        if (ISVISIBLE(client))
-            n++;
-    if (n > 0) /* override layout symbol */
-        snprintf(monitor->ltsymbol, sizeof monitor->ltsymbol, "[%d]", n);
-    for (client = nexttiled(monitor->clients); client; client = nexttiled(client->next))
+    if (monitor->nvisible > 0) /* override layout symbol */
+        snprintf(monitor->ltsymbol, sizeof monitor->ltsymbol, "[%d]", monitor->nvisible);
+    for (client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext))
         resize(client, monitor->window_x, monitor->window_y, monitor->window_width - 2 * client->bw, monitor->window_height - 2 * client->bw, 0);
 }
 
-void
-motionnotify(XEvent *event)
-{
-    static Monitor *mon = NULL;
-    Monitor *monitor;
-    XMotionEvent *motion_event = &event->xmotion;
-
-    if (motion_event->window != root)
-        return;
-    if ((monitor = recttomon(motion_event->x_root, motion_event->y_root, 1, 1)) != mon && mon) {
-        unfocus(selected_monitor->selected_client, 1);
-        selected_monitor = monitor;
-        focus(NULL);
-    }
-    mon = monitor;
-}
-
 void
 movemouse(const Arg *arg)
 {
-    int x_pos, y_pos, ocx, ocy, nx, ny;
+    int x_pos, y_pos, ocx, ocy, nx, ny, ox, oy, ow, oh;
     Client *client;
     Monitor *monitor;
     XEvent event;
     Time lasttime = 0;
+    unsigned int interval;
+    int held = 0;
+    GC gc = NULL;
 
     if (!(client = selected_monitor->selected_client))
         return;
     if (client->isfullscreen) /* no support moving fullscreen windows by mouse */
         return;
+    interval = 1000 / selected_monitor->refresh;
     restack(selected_monitor);
     ocx = client->x_pos;
     ocy = client->y_pos;
     if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,
     None, cursor[CurMove]->cursor, CurrentTime) != GrabSuccess)
         return;
-    if (!getrootptr(&x_pos, &y_pos))
-        return;
+    x_pos = pointer_x;
+    y_pos = pointer_y;
+    ox = ocx;
+    oy = ocy;
+    ow = client->width;
+    oh = client->height;
+    if (client->wireframe) {
+        /* nobody may paint under the frame while it is up */
+        XGrabServer(dpy);
+        gc = outlinegc();
+        drawoutline(gc, client, ox, oy, ow, oh);
+    }
     do {
-        XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &event);
+        dragevent(&event);
+        trackpointer(&event);
         switch(event.type) {
         case ConfigureRequest:
         case Expose:
         case MapRequest:
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
             handler[event.type](&event);
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
             break;
+        case ButtonRelease:
+            if (!held)
+                break;
+            /* fall through: the last step was held back, land where the button went up */
         case MotionNotify:
-            if ((event.xmotion.time - lasttime) <= (1000 / 60))
-                continue;
-            lasttime = event.xmotion.time;
+            if (event.type == MotionNotify) {
+                compressmotion(&event);
+                if ((event.xmotion.time - lasttime) <= interval) {
+                    held = 1;
+                    continue;
+                }
+                lasttime = event.xmotion.time;
+            }
+            held = 0;
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
 
-            nx = ocx + (event.xmotion.x - x_pos);
-            ny = ocy + (event.xmotion.y - y_pos);
+            nx = ocx + (pointer_x - x_pos);
+            ny = ocy + (pointer_y - y_pos);
             if (nx >= selected_monitor->window_x && nx <= selected_monitor->window_x + selected_monitor->window_width
             && ny >= selected_monitor->window_y && ny <= selected_monitor->window_y + selected_monitor->window_height) {
                 if (abs(selected_monitor->window_x - nx) < snap)
@@ -1291,11 +2251,29 @@ movemouse(const Arg *arg)
                 && (abs(nx - client->x_pos) > snap || abs(ny - client->y_pos) > snap))
                     togglefloating(NULL);
             }
-            if (!selected_monitor->lt[selected_monitor->sellt]->arrange || client->isfloating)
-                resize(client, nx, ny, client->width, client->height, 1);
+            if (!selected_monitor->lt[selected_monitor->sellt]->arrange || client->isfloating) {
+                if (gc) {
+                    ow = client->width;
+                    oh = client->height;
+                    applysizehints(client, &nx, &ny, &ow, &oh, 1);
+                    ox = nx;
+                    oy = ny;
+                } else
+                    resize(client, nx, ny, client->width, client->height, 1);
+            }
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
+            XFlush(dpy);
             break;
         }
     } while (event.type != ButtonRelease);
+    if (gc) {
+        drawoutline(gc, client, ox, oy, ow, oh);
+        XFreeGC(dpy, gc);
+        XUngrabServer(dpy);
+        if (!selected_monitor->lt[selected_monitor->sellt]->arrange || client->isfloating)
+            resize(client, ox, oy, ow, oh, 1);
+    }
     XUngrabPointer(dpy, CurrentTime);
     if ((monitor = recttomon(client->x_pos, client->y_pos, client->width, client->height)) != selected_monitor) {
         sendmon(client, monitor);
@@ -1307,10 +2285,63 @@ movemouse(const Arg *arg)
 Client *
 nexttiled(Client *client)
 {
-    for (; client && (client->isfloating || !ISVISIBLE(client)); client = client->next);
+    for (; client && client->isfloating; client = client->vnext);
     return client;
 }
 
+long long
+nowms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+GC
+outlinegc(void)
+{
+    XGCValues gcv;
+
+    gcv.function = GXxor;
+    gcv.subwindow_mode = IncludeInferiors;
+    gcv.foreground = WhitePixel(dpy, screen) ^ BlackPixel(dpy, screen);
+    return XCreateGC(dpy, root, GCFunction|GCSubwindowMode|GCForeground, &gcv);
+}
+
+/* the layout cache slot of the view, one per single tag, the last for any other view */
+unsigned int
+planslot(Monitor *monitor)
+{
+    unsigned int tagset = monitor->tagset[monitor->seltags];
+    unsigned int i;
+
+    if (tagset & (tagset - 1))
+        return LENGTH(tags);
+    for (i = 0; i < LENGTH(tags) && !(tagset & 1 << i); i++);
+    return i;
+}
+
+/* the monitor whose window area holds the point, NULL if there is none */
+Monitor *
+pointtomon(int x_pos, int y_pos)
+{
+    unsigned int lo = 0, hi = nmons, mid;
+
+    /* past the last monitor starting at or left of the point */
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (monbyx[mid]->window_x <= x_pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    while (lo-- > 0)
+        if (CONTAINS(monbyx[lo], x_pos, y_pos, 1, 1))
+            return monbyx[lo];
+    return NULL;
+}
+
 void
 pop(Client *client)
 {
@@ -1336,8 +2367,10 @@ propertynotify(XEvent *event)
         default: break;
         case XA_WM_TRANSIENT_FOR:
             if (!client->isfloating && (XGetTransientForHint(dpy, client->win, &trans)) &&
-               (client->isfloating = (wintoclient(trans)) != NULL))
+               (client->isfloating = (wintoclient(trans)) != NULL)) {
+                updatecontainer(client, 1);
                 arrange(client->mon);
+            }
             break;
         case XA_WM_NORMAL_HINTS:
             updatesizehints(client);
@@ -1352,8 +2385,21 @@ propertynotify(XEvent *event)
             if (client == client->mon->selected_client)
                 drawbar(client->mon);
         }
-        if (property_event->atom == netatom[NetWMWindowType])
+        if (property_event->atom == netatom[NetWMWindowType]) {
             updatewindowtype(client);
+            updatecontainer(client, 1);
+        }
+        else if (property_event->atom == netatom[NetWMState]) {
+            /* updatenetstate() already knows what it wrote */
+            if (property_event->serial == client->cold->stateserial)
+                client->cold->stateserial = 0;
+            else
+                updatewinstate(client);
+        }
+        /* the counter may show up after mapping, updateprotocols() reads both */
+        if (property_event->atom == wmatom[WMProtocols]
+        || property_event->atom == netatom[NetWMSyncRequestCounter])
+            updateprotocols(client);
     }
 }
 
@@ -1363,20 +2409,21 @@ pushstack(const Arg *arg)
     int i = stackpos(arg);
     Client *sel = selected_monitor->selected_client, *client, *p;
 
-    if(i < 0)
+    if(i < 0 || !sel)
         return;
     else if(i == 0) {
         detach(sel);
         attach(sel);
     }
     else {
-        for(p = NULL, client = selected_monitor->clients; client; p = client, client = client->next)
-            if(!(i -= (ISVISIBLE(client) && client != sel)))
+        for(p = NULL, client = selected_monitor->visible; client; p = client, client = client->vnext)
+            if(!(i -= (client != sel)))
                 break;
         client = client ? client : p;
+        if (client == sel)
+            return;
         detach(sel);
-        sel->next = client->next;
-        client->next = sel;
+        attachafter(sel, client);
     }
     arrange(selected_monitor);
 }
@@ -1387,20 +2434,142 @@ quit(const Arg *arg)
     running = 0;
 }
 
+void
+raiseclient(Client *client)
+{
+    XWindowChanges window_changes;
+
+    /* inside a container only above its siblings, the container itself
+     * goes no higher than right below the bar */
+    XRaiseWindow(dpy, client->win);
+    if (client->cold->container) {
+        window_changes.sibling = client->mon->barwin;
+        window_changes.stack_mode = Below;
+        XConfigureWindow(dpy, client->cold->container, CWSibling|CWStackMode, &window_changes);
+        client->mon->nstackorder = 0;
+    }
+}
+
+/* takes "name text" lines from statusfifo, a name alone drops its segment */
+void
+readstatus(void)
+{
+    static char buf[1024];
+    static size_t len;
+    char *line, *end;
+    ssize_t n;
+    int changed = 0;
+
+    while ((n = read(statusfd, buf + len, sizeof buf - 1 - len)) > 0) {
+        len += n;
+        buf[len] = '\0';
+        for (line = buf; (end = strchr(line, '\n')); line = end + 1) {
+            *end = '\0';
+            changed |= setstatusseg(line);
+        }
+        len -= line - buf;
+        memmove(buf, line, len);
+        if (len == sizeof buf - 1)
+            len = 0; /* no newline in sight, drop it */
+    }
+    if (changed) {
+        composestatus();
+        drawstatus(selected_monitor);
+    }
+}
+
+void
+recordplan(Monitor *monitor)
+{
+    LayoutPlan *plan = &monitor->plans[planslot(monitor)];
+    Client *client;
+    unsigned int n;
+    int *geom;
+
+    for (n = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), n++);
+    if (n > plan->size) {
+        plan->wins = erealloc(plan->wins, n * sizeof(Window));
+        plan->geom = erealloc(plan->geom, 5 * n * sizeof(int));
+        plan->size = n;
+    }
+    for (n = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), n++) {
+        geom = &plan->geom[5 * n];
+        plan->wins[n] = client->win;
+        geom[0] = client->x_pos;
+        geom[1] = client->y_pos;
+        geom[2] = client->width;
+        geom[3] = client->height;
+        geom[4] = client->cold->cfgbw;
+    }
+    plan->n = n;
+    plan->lt = monitor->lt[monitor->sellt];
+    plan->mfact = monitor->mfact;
+    plan->nmaster = monitor->nmaster;
+    plan->window_x = monitor->window_x;
+    plan->window_y = monitor->window_y;
+    plan->window_width = monitor->window_width;
+    plan->window_height = monitor->window_height;
+    plan->nvisible = monitor->nvisible;
+    memcpy(plan->ltsymbol, monitor->ltsymbol, sizeof plan->ltsymbol);
+}
+
 Monitor *
 recttomon(int x_pos, int y_pos, int width, int height)
 {
     Monitor *m, *r = selected_monitor;
     int a, area = 0;
 
+    /* most rects lie within one monitor, usually the one found last time */
+    if ((m = lasthit) && CONTAINS(m, x_pos, y_pos, width, height))
+        return m;
+    if ((m = pointtomon(x_pos, y_pos)) && CONTAINS(m, x_pos, y_pos, width, height))
+        return lasthit = m;
     for (m = monitor_start; m; m = m->next)
         if ((a = INTERSECT(x_pos, y_pos, width, height, m)) > area) {
             area = a;
-            r = m;
+            r = lasthit = m;
         }
     return r;
 }
 
+int
+replayplan(Monitor *monitor)
+{
+    LayoutPlan *plan = &monitor->plans[planslot(monitor)];
+    Client *client;
+    unsigned int n;
+    int *geom;
+
+    if (plan->lt != monitor->lt[monitor->sellt] || plan->mfact != monitor->mfact
+    || plan->nmaster != monitor->nmaster || plan->nvisible != monitor->nvisible
+    || plan->window_x != monitor->window_x || plan->window_y != monitor->window_y
+    || plan->window_width != monitor->window_width || plan->window_height != monitor->window_height)
+        return 0;
+    for (n = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), n++)
+        if (n == plan->n || plan->wins[n] != client->win)
+            return 0;
+    if (n != plan->n)
+        return 0;
+
+    memcpy(monitor->ltsymbol, plan->ltsymbol, sizeof monitor->ltsymbol);
+    for (n = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), n++) {
+        geom = &plan->geom[5 * n];
+        if (client->x_pos == geom[0] && client->y_pos == geom[1] && client->width == geom[2]
+        && client->height == geom[3] && client->cold->cfgbw == geom[4])
+            continue; /* already there, no configure */
+        client->cold->oldx = client->x_pos; client->x_pos = geom[0];
+        client->cold->oldy = client->y_pos; client->y_pos = geom[1];
+        client->cold->oldw = client->width; client->width = geom[2];
+        client->cold->oldh = client->height; client->height = geom[3];
+        client->cold->cfgbw = geom[4];
+        if (client->syncwait)
+            client->syncqueued = 1;
+        else
+            sendconfigure(client);
+    }
+    return 1;
+}
+
 void
 resize(Client *client, int x_pos, int y_pos, int width, int height, int interact)
 {
@@ -1411,57 +2580,63 @@ resize(Client *client, int x_pos, int y_pos, int width, int height, int interact
 void
 resizeclient(Client *client, int x_pos, int y_pos, int width, int height)
 {
-    XWindowChanges window_changes;
     unsigned int n;
     unsigned int gapoffset;
     unsigned int gapincr;
     Client *nbc;
 
-    window_changes.border_width = client->bw;
+    client->cold->cfgbw = client->bw;
 
-    /* Get number of clients for the selected monitor */
-    for (n = 0, nbc = nexttiled(selected_monitor->clients); nbc; nbc = nexttiled(nbc->next), n++);
+    /* Get number of clients for the client's monitor */
+    for (n = 0, nbc = nexttiled(client->mon->visible); nbc; nbc = nexttiled(nbc->vnext), n++);
 
     /* Do nothing if layout is floating */
-    if (client->isfloating || selected_monitor->lt[selected_monitor->sellt]->arrange == NULL)
+    if (client->isfloating || client->mon->lt[client->mon->sellt]->arrange == NULL)
     {
         gapincr = gapoffset = 0;
     } else {
         /* Remove border and gap if layout is monocle or only one client */
-        if (selected_monitor->lt[selected_monitor->sellt]->arrange == monocle || n == 1)
+        if (client->mon->lt[client->mon->sellt]->arrange == monocle || n == 1)
         {
             gapoffset = 0;
             gapincr = -2 * borderpx;
-            window_changes.border_width = 0;
+            client->cold->cfgbw = 0;
         } else {
             gapoffset = window_gap;
             gapincr = 2 * window_gap;
         }
     }
 
-    client->oldx = client->x_pos; client->x_pos = window_changes.x = x_pos + gapoffset;
-    client->oldy = client->y_pos; client->y_pos = window_changes.y = y_pos + gapoffset;
-    client->oldw = client->width; client->width = window_changes.width = width - gapincr;
-    client->oldh = client->height; client->height = window_changes.height = height - gapincr;
+    client->cold->oldx = client->x_pos; client->x_pos = x_pos + gapoffset;
+    client->cold->oldy = client->y_pos; client->y_pos = y_pos + gapoffset;
+    client->cold->oldw = client->width; client->width = width - gapincr;
+    client->cold->oldh = client->height; client->height = height - gapincr;
 
-    XConfigureWindow(dpy, client->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &window_changes);
-    configure(client);
-    XSync(dpy, False);
+    if (client->syncwait) {
+        /* still painting the last size, syncdone() sends the newest one */
+        client->syncqueued = 1;
+        return;
+    }
+    sendconfigure(client);
 }
 
 void
 resizemouse(const Arg *arg)
 {
-    int ocx, ocy, nw, nh;
+    int ocx, ocy, nw, nh, ox, oy, ow, oh;
     Client *client;
     Monitor *monitor;
     XEvent event;
     Time lasttime = 0;
+    unsigned int interval;
+    int held = 0;
+    GC gc = NULL;
 
     if (!(client = selected_monitor->selected_client))
         return;
     if (client->isfullscreen) /* no support resizing fullscreen windows by mouse */
         return;
+    interval = 1000 / selected_monitor->refresh;
     restack(selected_monitor);
     ocx = client->x_pos;
     ocy = client->y_pos;
@@ -1469,21 +2644,47 @@ resizemouse(const Arg *arg)
                     None, cursor[CurResize]->cursor, CurrentTime) != GrabSuccess)
         return;
     XWarpPointer(dpy, None, client->win, 0, 0, 0, 0, client->width + client->bw - 1, client->height + client->bw - 1);
+    ox = ocx;
+    oy = ocy;
+    ow = client->width;
+    oh = client->height;
+    if (client->wireframe) {
+        XGrabServer(dpy);
+        gc = outlinegc();
+        drawoutline(gc, client, ox, oy, ow, oh);
+    }
     do {
-        XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &event);
+        dragevent(&event);
+        trackpointer(&event);
         switch(event.type) {
         case ConfigureRequest:
         case Expose:
         case MapRequest:
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
             handler[event.type](&event);
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
             break;
+        case ButtonRelease:
+            if (!held)
+                break;
+            /* fall through: the last step was held back, land where the button went up */
         case MotionNotify:
-            if ((event.xmotion.time - lasttime) <= (1000 / 60))
-                continue;
-            lasttime = event.xmotion.time;
+            if (event.type == MotionNotify) {
+                compressmotion(&event);
+                if ((event.xmotion.time - lasttime) <= interval) {
+                    held = 1;
+                    continue;
+                }
+                lasttime = event.xmotion.time;
+            }
+            held = 0;
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
 
-            nw = MAX(event.xmotion.x - ocx - 2 * client->bw + 1, 1);
-            nh = MAX(event.xmotion.y - ocy - 2 * client->bw + 1, 1);
+            nw = MAX(pointer_x - ocx - 2 * client->bw + 1, 1);
+            nh = MAX(pointer_y - ocy - 2 * client->bw + 1, 1);
             if (client->mon->window_x + nw >= selected_monitor->window_x && client->mon->window_x + nw <= selected_monitor->window_x + selected_monitor->window_width
             && client->mon->window_y + nh >= selected_monitor->window_y && client->mon->window_y + nh <= selected_monitor->window_y + selected_monitor->window_height)
             {
@@ -1491,12 +2692,32 @@ resizemouse(const Arg *arg)
                 && (abs(nw - client->width) > snap || abs(nh - client->height) > snap))
                     togglefloating(NULL);
             }
-            if (!selected_monitor->lt[selected_monitor->sellt]->arrange || client->isfloating)
-                resize(client, client->x_pos, client->y_pos, nw, nh, 1);
+            if (!selected_monitor->lt[selected_monitor->sellt]->arrange || client->isfloating) {
+                if (gc) {
+                    ox = client->x_pos;
+                    oy = client->y_pos;
+                    ow = nw;
+                    oh = nh;
+                    applysizehints(client, &ox, &oy, &ow, &oh, 1);
+                } else
+                    resize(client, client->x_pos, client->y_pos, nw, nh, 1);
+            }
+            if (gc)
+                drawoutline(gc, client, ox, oy, ow, oh);
+            XFlush(dpy);
             break;
         }
     } while (event.type != ButtonRelease);
+    if (gc) {
+        drawoutline(gc, client, ox, oy, ow, oh);
+        XFreeGC(dpy, gc);
+        XUngrabServer(dpy);
+        if (!selected_monitor->lt[selected_monitor->sellt]->arrange || client->isfloating)
+            resize(client, ox, oy, ow, oh, 1);
+    }
     XWarpPointer(dpy, None, client->win, 0, 0, 0, 0, client->width + client->bw - 1, client->height + client->bw - 1);
+    pointer_x = client->x_pos + client->width + 2 * client->bw - 1;
+    pointer_y = client->y_pos + client->height + 2 * client->bw - 1;
     XUngrabPointer(dpy, CurrentTime);
     while (XCheckMaskEvent(dpy, EnterWindowMask, &event));
     if ((monitor = recttomon(client->x_pos, client->y_pos, client->width, client->height)) != selected_monitor) {
@@ -1510,38 +2731,222 @@ void
 restack(Monitor *monitor)
 {
     Client *c;
-    XEvent ev;
-    XWindowChanges wc;
+    unsigned int i, n, start, added;
 
     drawbar(monitor);
     if (!monitor->selected_client)
         return;
     if (monitor->selected_client->isfloating || !monitor->lt[monitor->sellt]->arrange)
-        XRaiseWindow(dpy, monitor->selected_client->win);
+        raiseclient(monitor->selected_client);
     if (monitor->lt[monitor->sellt]->arrange) {
-        wc.stack_mode = Below;
-        wc.sibling = monitor->barwin;
-        for (c = monitor->stack; c; c = c->snext)
-            if (!c->isfloating && ISVISIBLE(c)) {
-                XConfigureWindow(dpy, c->win, CWSibling|CWStackMode, &wc);
-                wc.sibling = c->win;
+        /* tiled clients go below the bar in focus order, sent only when the
+         * order differs from the one committed last time: one request for
+         * the root, then one per container for the clients inside it, as
+         * monocle stacks them on top of each other */
+        for (n = 1, c = monitor->vstack; c; c = c->vsnext)
+            if (!c->isfloating)
+                n += 3;
+        if (n > restackbufsize)
+            restackbuf = erealloc(restackbuf, (restackbufsize = n) * sizeof(Window));
+        restackbuf[0] = monitor->barwin;
+        for (n = 1, added = 0, c = monitor->vstack; c; c = c->vsnext) {
+            if (c->isfloating)
+                continue;
+            if (!containers || !c->cold->container)
+                restackbuf[n++] = c->win;
+            else if (!(added & c->tags)) {
+                added |= c->tags;
+                restackbuf[n++] = c->cold->container;
             }
+        }
+        for (i = 0; i < LENGTH(tags); i++)
+            if (added & 1 << i) {
+                restackbuf[n++] = None; /* ends the previous request */
+                for (c = monitor->vstack; c; c = c->vsnext)
+                    if (!c->isfloating && c->cold->container == monitor->tagwin[i])
+                        restackbuf[n++] = c->win;
+            }
+        if (n != monitor->nstackorder || memcmp(restackbuf, monitor->stackorder, n * sizeof(Window))) {
+            for (start = i = 0; i <= n; i++)
+                if (i == n || restackbuf[i] == None) {
+                    if (i - start > 1)
+                        XRestackWindows(dpy, restackbuf + start, i - start);
+                    start = i + 1;
+                }
+            lowerdesks();
+            monitor->stackorder = erealloc(monitor->stackorder, n * sizeof(Window));
+            memcpy(monitor->stackorder, restackbuf, n * sizeof(Window));
+            monitor->nstackorder = n;
+        }
+    } else
+        monitor->nstackorder = 0; /* a raised tiled client breaks the committed order */
+    /* crossing events caused by the requests above carry a serial older
+     * than the NoOp, enternotify() drops them without a round trip */
+    enterserial = NextRequest(dpy);
+    XNoOp(dpy);
+    if (monitor == selected_monitor && (monitor->tagset[monitor->seltags] & monitor->selected_client->tags))
+        warp(monitor->selected_client);
+}
+
+void
+run(void)
+{
+    XEvent ev;
+    struct pollfd pfd[3 + MAXIPCCLIENTS];
+    unsigned int i;
+    int timeout;
+
+    pfd[0].fd = ConnectionNumber(dpy);
+    pfd[1].fd = statusfd; /* ignored by poll() while negative */
+    pfd[2].fd = ipcfd;
+    pfd[0].events = pfd[1].events = pfd[2].events = POLLIN;
+    /* main event loop, sleeps in poll() until the next event or timer */
+    XSync(dpy, False);
+    while (running) {
+        timeout = runtimers();
+        if (shapepending)
+            flushshapes();
+        if (occchanged)
+            ipcnotifyocc();
+        if (XPending(dpy)) {
+            XNextEvent(dpy, &ev);
+            dispatch(&ev);
+            continue;
+        }
+        for (i = 0; i < LENGTH(ipcclients); i++) {
+            pfd[3 + i].fd = ipcclients[i].fd;
+            pfd[3 + i].events = POLLIN | (ipcclients[i].outlen ? POLLOUT : 0);
+        }
+        if (poll(pfd, LENGTH(pfd), timeout) == -1) {
+            if (errno != EINTR)
+                die("poll:");
+            continue;
+        }
+        if (pfd[1].revents & POLLIN)
+            readstatus();
+        if (pfd[2].revents & POLLIN)
+            ipcaccept();
+        for (i = 0; i < LENGTH(ipcclients); i++)
+            if (pfd[3 + i].revents && ipcclients[i].fd >= 0)
+                ipcio(&ipcclients[i], pfd[3 + i].revents);
+    }
+}
+
+/* fires the timers that are due, returns the ms until the next one or -1 */
+int
+runtimers(void)
+{
+    Timer *timer;
+    long long now = nowms();
+
+    while ((timer = timers) && timer->due <= now) {
+        timers = timer->next;
+        timer->due = 0;
+        timer->fire(timer);
+    }
+    return timers ? (int)(timers->due - now) : -1;
+}
+
+/* reads cpu ticks and resident pages through fds kept open by one client
+ * of each process, see sampleusage() */
+void
+sampleclient(Client *client, long long elapsed)
+{
+    ClientCold *cold = client->cold;
+    char buf[512], *p;
+    unsigned long long utime, stime;
+    unsigned long resident;
+    ssize_t n;
+
+    if (!cold->pid || cold->statfd == -2)
+        return;
+    if (cold->statfd == -1) {
+        snprintf(buf, sizeof buf, "/proc/%d/stat", (int)cold->pid);
+        cold->statfd = open(buf, O_RDONLY|O_CLOEXEC);
+        snprintf(buf, sizeof buf, "/proc/%d/statm", (int)cold->pid);
+        cold->statmfd = open(buf, O_RDONLY|O_CLOEXEC);
     }
-    XSync(dpy, False);
-    while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
-    if (monitor == selected_monitor && (monitor->tagset[monitor->seltags] & monitor->selected_client->tags))
-        warp(monitor->selected_client);
+    /* the command name may hold anything, fields are counted from its ')' */
+    if (cold->statfd < 0 || (n = pread(cold->statfd, buf, sizeof buf - 1, 0)) <= 0
+    || (buf[n] = '\0', !(p = strrchr(buf, ')')))
+    || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2
+    || cold->statmfd < 0 || (n = pread(cold->statmfd, buf, sizeof buf - 1, 0)) <= 0
+    || (buf[n] = '\0', sscanf(buf, "%*u %lu", &resident) != 1)) {
+        if (cold->statfd >= 0)
+            close(cold->statfd);
+        if (cold->statmfd >= 0)
+            close(cold->statmfd);
+        cold->statfd = cold->statmfd = -2;
+        cold->cpu = cold->rss = 0;
+        return;
+    }
+    cold->cpu = cold->cputicks && elapsed > 0
+        ? (utime + stime - cold->cputicks) * 1000000 / (sysconf(_SC_CLK_TCK) * elapsed) : 0;
+    cold->cputicks = utime + stime;
+    cold->rss = resident * (sysconf(_SC_PAGESIZE) / 1024);
 }
 
+/* samples every process once, sums them per tag and publishes the lot as
+ * _DWM_USAGE */
 void
-run(void)
+sampleusage(Timer *timer)
 {
-    XEvent ev;
-    /* main event loop */
-    XSync(dpy, False);
-    while (running && !XNextEvent(dpy, &ev))
-        if (handler[ev.type])
-            handler[ev.type](&ev); /* call handler */
+    Monitor *monitor;
+    Client *client, *owner;
+    long long now = nowms();
+    size_t len = 0, n = 0, j, k, l;
+    unsigned int i, tagmask;
+
+    if (clientslab.live > usagesortsize)
+        usagesort = erealloc(usagesort, (usagesortsize = clientslab.live) * sizeof(Client *));
+    for (monitor = monitor_start; monitor; monitor = monitor->next) {
+        memset(monitor->tagcpu, 0, sizeof monitor->tagcpu);
+        memset(monitor->tagrss, 0, sizeof monitor->tagrss);
+        for (client = monitor->clients; client; client = client->next)
+            if (client->cold->pid)
+                usagesort[n++] = client;
+    }
+    qsort(usagesort, n, sizeof(Client *), cmppid);
+    for (j = 0; j < n; j = k) {
+        /* the client holding the process's fds samples it for all its windows */
+        for (owner = usagesort[j], k = j; k < n && usagesort[k]->cold->pid == owner->cold->pid; k++)
+            if (usagesort[k]->cold->statfd != -1)
+                owner = usagesort[k];
+        sampleclient(owner, now - lastsample);
+        /* and counts once per tag of each monitor it has windows on */
+        for (tagmask = 0, l = j; l < k; l++) {
+            client = usagesort[l];
+            client->cold->cpu = owner->cold->cpu;
+            client->cold->rss = owner->cold->rss;
+            tagmask |= client->tags;
+            if (l + 1 < k && usagesort[l + 1]->mon == client->mon)
+                continue;
+            for (i = 0; i < LENGTH(tags); i++)
+                if (tagmask & 1 << i) {
+                    client->mon->tagcpu[i] += owner->cold->cpu;
+                    client->mon->tagrss[i] += owner->cold->rss;
+                }
+            tagmask = 0;
+        }
+    }
+    lastsample = now;
+
+    /* one line per client, then per tag of each monitor */
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        for (client = monitor->clients; client; client = client->next)
+            usageappend(&len, "client 0x%lx pid %d cpu %u.%u rss %lu\n",
+                        client->win, (int)client->cold->pid, client->cold->cpu / 10, client->cold->cpu % 10,
+                        client->cold->rss);
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        for (i = 0; i < LENGTH(tags); i++)
+            usageappend(&len, "tag %d %s cpu %u.%u rss %lu\n",
+                        monitor->num, tags[i], monitor->tagcpu[i] / 10, monitor->tagcpu[i] % 10,
+                        monitor->tagrss[i]);
+    XChangeProperty(dpy, root, dwmatom[DWMUsage], XA_STRING, 8,
+                    PropModeReplace, (unsigned char *)usagebuf, len);
+    if (showusage)
+        drawbars();
+    armtimer(timer, usageinterval);
 }
 
 void
@@ -1583,8 +2988,10 @@ sendmon(Client *client, Monitor *monitor)
     client->tags = monitor->tagset[monitor->seltags]; /* assign tags of target monitor */
     attach(client);
     attachstack(client);
+    updatecontainer(client, 1);
     focus(NULL);
     arrange(NULL);
+    updatecgroup(client);
 }
 
 void
@@ -1596,25 +3003,37 @@ setclientstate(Client *client, long state)
             PropModeReplace, (unsigned char *)data, 2);
 }
 
+void
+sendconfigure(Client *client)
+{
+    XWindowChanges wc;
+
+    /* clients hidden by updatevisible() stay off screen */
+    wc.x = client->isshown ? WINX(client) : WIDTH(client) * -2;
+    wc.y = WINY(client);
+    wc.width = client->width;
+    wc.height = client->height;
+    wc.border_width = client->cold->cfgbw;
+    if (client->protocols & (1 << WMSyncRequest))
+        syncrequest(client);
+    XConfigureWindow(dpy, client->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
+    configure(client);
+    if (client->cold->container)
+        markshape(client->cold->container);
+}
+
 int
-sendevent(Client *client, Atom proto)
+sendevent(Client *client, int proto)
 {
-    int n;
-    Atom *protocols;
-    int exists = 0;
+    int exists = client->protocols & (1 << proto);
     XEvent event;
 
-    if (XGetWMProtocols(dpy, client->win, &protocols, &n)) {
-        while (!exists && n--)
-            exists = protocols[n] == proto;
-        XFree(protocols);
-    }
     if (exists) {
         event.type = ClientMessage;
         event.xclient.window = client->win;
         event.xclient.message_type = wmatom[WMProtocols];
         event.xclient.format = 32;
-        event.xclient.data.l[0] = proto;
+        event.xclient.data.l[0] = wmatom[proto];
         event.xclient.data.l[1] = CurrentTime;
         XSendEvent(dpy, client->win, False, NoEventMask, &event);
     }
@@ -1630,37 +3049,56 @@ setfocus(Client *client)
                         XA_WINDOW, 32, PropModeReplace,
                         (unsigned char *) &(client->win), 1);
     }
-    sendevent(client, wmatom[WMTakeFocus]);
+    sendevent(client, WMTakeFocus);
 }
 
 void
 setfullscreen(Client *client, int fullscreen)
 {
     if (fullscreen && !client->isfullscreen) {
-        XChangeProperty(dpy, client->win, netatom[NetWMState], XA_ATOM, 32,
-                        PropModeReplace, (unsigned char*)&netatom[NetWMFullscreen], 1);
         client->isfullscreen = 1;
-        client->oldstate = client->isfloating;
-        client->oldbw = client->bw;
+        updatenetstate(client);
+        client->cold->oldstate = client->isfloating;
+        client->cold->oldbw = client->bw;
         client->bw = 0;
         client->isfloating = 1;
+        updatecontainer(client, 1);
         resizeclient(client, client->mon->mon_x, client->mon->mon_y, client->mon->mon_width, client->mon->mon_height);
-        XRaiseWindow(dpy, client->win);
+        raiseclient(client);
     } else if (!fullscreen && client->isfullscreen){
-        XChangeProperty(dpy, client->win, netatom[NetWMState], XA_ATOM, 32,
-                        PropModeReplace, (unsigned char*)0, 0);
         client->isfullscreen = 0;
-        client->isfloating = client->oldstate;
-        client->bw = client->oldbw;
-        client->x_pos = client->oldx;
-        client->y_pos = client->oldy;
-        client->width = client->oldw;
-        client->height = client->oldh;
+        updatenetstate(client);
+        client->isfloating = client->cold->oldstate;
+        updatecontainer(client, 1);
+        client->bw = client->cold->oldbw;
+        client->x_pos = client->cold->oldx;
+        client->y_pos = client->cold->oldy;
+        client->width = client->cold->oldw;
+        client->height = client->cold->oldh;
         resizeclient(client, client->x_pos, client->y_pos, client->width, client->height);
         arrange(client->mon);
     }
 }
 
+void
+seturgent(Client *client, int urgent)
+{
+    if (client->isurgent == urgent)
+        return;
+    counttags(client, -1);
+    client->isurgent = urgent;
+    counttags(client, +1);
+}
+
+/* lets clients on hidden tags throttle themselves, they stay mapped */
+void
+sethidden(Client *client, int hidden)
+{
+    client->ishidden = hidden;
+    setclientstate(client, hidden ? IconicState : NormalState);
+    updatenetstate(client);
+}
+
 void
 setlayout(const Arg *arg)
 {
@@ -1673,6 +3111,7 @@ setlayout(const Arg *arg)
         arrange(selected_monitor);
     else
         drawbar(selected_monitor);
+    ipcevent(IpcEvLayout, "layout %d %s\n", selected_monitor->num, selected_monitor->ltsymbol);
 }
 
 /* arg > 1.0 will set mfact absolutly */
@@ -1690,10 +3129,45 @@ setmfact(const Arg *arg)
     arrange(selected_monitor);
 }
 
+/* returns whether the status text changes */
+int
+setstatusseg(char *line)
+{
+    char *text;
+    unsigned int i;
+
+    if ((text = strchr(line, ' ')))
+        *text++ = '\0';
+    else
+        text = "";
+    /* names are kept cut to their first 15 bytes, compare no more */
+    for (i = 0; i < nstatussegs && strncmp(statussegs[i].name, line, sizeof statussegs[i].name - 1); i++);
+    if (!*text) {
+        if (i == nstatussegs)
+            return 0;
+        memmove(&statussegs[i], &statussegs[i + 1], (--nstatussegs - i) * sizeof statussegs[0]);
+        return 1;
+    }
+    if (i == nstatussegs) {
+        if (!*line || nstatussegs == LENGTH(statussegs))
+            return 0;
+        snprintf(statussegs[i].name, sizeof statussegs[i].name, "%.15s", line);
+        statussegs[i].text[0] = '\0';
+        nstatussegs++;
+    }
+    if (!strncmp(statussegs[i].text, text, sizeof statussegs[i].text - 1))
+        return 0;
+    snprintf(statussegs[i].text, sizeof statussegs[i].text, "%s", text);
+    return 1;
+}
+
 void
 setup(void)
 {
     XSetWindowAttributes window_attributes;
+    struct stat st;
+    int di;
+    size_t i;
 
     /* clean up any zombies immediately */
     sigchld(0);
@@ -1703,6 +3177,13 @@ setup(void)
     screen_width = DisplayWidth(dpy, screen);
     sh = DisplayHeight(dpy, screen);
     root = RootWindow(dpy, screen);
+    getrootptr(&pointer_x, &pointer_y);
+#ifdef XRANDR
+    if (XRRQueryExtension(dpy, &rrevent, &di))
+        XRRSelectInput(dpy, root, RRScreenChangeNotifyMask|RRCrtcChangeNotifyMask);
+    else
+        rrevent = -1;
+#endif /* XRANDR */
     drw = drw_create(dpy, screen, root, screen_width, sh);
     drw_load_fonts(drw, fonts, LENGTH(fonts));
     if (!drw->fontcount)
@@ -1714,14 +3195,25 @@ setup(void)
     wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
     wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
     wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
+    wmatom[WMSyncRequest] = netatom[NetWMSyncRequest] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+    netatom[NetWMSyncRequestCounter] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
     netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
     netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
     netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
     netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
     netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+    netatom[NetWMStateHidden] = XInternAtom(dpy, "_NET_WM_STATE_HIDDEN", False);
     netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
     netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
     netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+    netatom[NetWMPid] = XInternAtom(dpy, "_NET_WM_PID", False);
+    dwmatom[DWMStats] = XInternAtom(dpy, "_DWM_STATS", False);
+    dwmatom[DWMUsage] = XInternAtom(dpy, "_DWM_USAGE", False);
+    containers = tagcontainers && XShapeQueryExtension(dpy, &di, &di);
+    cgroups = cgroupbase[0] && !cg_init(cgroupmount, cgroupbase, cgroupweight, cgroupfreeze);
+    /* init sync extension */
+    if (!XSyncQueryExtension(dpy, &syncevent, &syncerror) || !XSyncInitialize(dpy, &di, &di))
+        syncevent = syncerror = -1;
     /* init cursors */
     cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
     cursor[CurResize] = drw_cur_create(drw, XC_sizing);
@@ -1737,36 +3229,63 @@ setup(void)
     /* init bars */
     updatebars();
     updatestatus();
+    updatestats();
     /* EWMH support per view */
     XChangeProperty(dpy, root, netatom[NetSupported], XA_ATOM, 32,
             PropModeReplace, (unsigned char *) netatom, NetLast);
     XDeleteProperty(dpy, root, netatom[NetClientList]);
     /* select for events */
     window_attributes.cursor = cursor[CurNormal]->cursor;
-    window_attributes.event_mask = SubstructureRedirectMask|SubstructureNotifyMask|ButtonPressMask|PointerMotionMask
+    window_attributes.event_mask = SubstructureRedirectMask|SubstructureNotifyMask|ButtonPressMask
                     |EnterWindowMask|LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
     XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &window_attributes);
     XSelectInput(dpy, root, window_attributes.event_mask);
     grabkeys();
     focus(NULL);
+    if (usageinterval)
+        armtimer(&usagetimer, usageinterval);
+    if (builtinstatus)
+        for (i = 0; i < LENGTH(statusmodules); i++) {
+            statusstate[i].fd = -1;
+            statustimers[i].fire = statustick;
+            armtimer(&statustimers[i], 0);
+        }
+    for (i = 0; i < LENGTH(ipcclients); i++)
+        ipcclients[i].fd = -1;
+    if (ipcsocket[0])
+        ipclisten();
+    if (statusfifo[0]) {
+        if ((mkfifo(statusfifo, 0600) < 0 && errno != EEXIST)
+        || (statusfd = open(statusfifo, O_RDONLY|O_NONBLOCK|O_CLOEXEC)) < 0)
+            fprintf(stderr, "dwm: cannot open %s\n", statusfifo);
+        else if (fstat(statusfd, &st) < 0 || !S_ISFIFO(st.st_mode)) {
+            /* a regular file would poll readable forever */
+            fprintf(stderr, "dwm: %s is not a FIFO\n", statusfifo);
+            close(statusfd);
+            statusfd = -1;
+        } else
+            /* a writer of our own, producers coming and going is no EOF then */
+            statuswfd = open(statusfifo, O_WRONLY|O_NONBLOCK|O_CLOEXEC);
+    }
 }
 
+/* clients leaving the view are hidden by updatevisible(), this only has
+ * to walk the visible stack */
 void
 showhide(Client *client)
 {
     if (!client)
         return;
-    if (ISVISIBLE(client)) {
-        /* show clients top down */
-        XMoveWindow(dpy, client->win, client->x_pos, client->y_pos);
-        if ((!client->mon->lt[client->mon->sellt]->arrange || client->isfloating) && !client->isfullscreen)
-            resize(client, client->x_pos, client->y_pos, client->width, client->height, 0);
-        showhide(client->snext);
-    } else {
-        /* hide clients bottom up */
-        showhide(client->snext);
-        XMoveWindow(dpy, client->win, WIDTH(client) * -2, client->y_pos);
+    /* show clients top down, those still in place need no request */
+    if (!client->isshown) {
+        XMoveWindow(dpy, client->win, WINX(client), WINY(client));
+        client->isshown = 1;
+        if (client->cold->container)
+            markshape(client->cold->container);
     }
+    if ((!client->mon->lt[client->mon->sellt]->arrange || client->isfloating) && !client->isfullscreen)
+        resize(client, client->x_pos, client->y_pos, client->width, client->height, 0);
+    showhide(client->vsnext);
 }
 
 void
@@ -1793,32 +3312,124 @@ spawn(const Arg *arg)
     }
 }
 
+void
+statustick(Timer *timer)
+{
+    size_t i = timer - statustimers;
+    char val[sizeof statusval[0]];
+
+    statusmodules[i].fn(&statusstate[i], statusmodules[i].arg, val, sizeof val);
+    if (strcmp(val, statusval[i])) {
+        strcpy(statusval[i], val);
+        composestatus();
+        drawstatus(selected_monitor);
+    }
+    armtimer(timer, statusmodules[i].interval);
+}
+
+void
+syncalarm(XEvent *event)
+{
+    XSyncAlarmNotifyEvent *alarm_event = (XSyncAlarmNotifyEvent *)event;
+    XSyncValue value;
+    Client *client;
+    Monitor *m;
+
+    for (m = monitor_start; m; m = m->next)
+        for (client = m->clients; client; client = client->next)
+            if (client->syncwait && client->cold->syncalarm == alarm_event->alarm) {
+                XSyncIntsToValue(&value, client->cold->syncvalue & 0xffffffff, client->cold->syncvalue >> 32);
+                /* a late ack for a request that already timed out does not count */
+                if (XSyncValueGreaterOrEqual(alarm_event->counter_value, value)) {
+                    client->cold->syncmisses = 0;
+                    syncdone(client);
+                }
+                return;
+            }
+}
+
+/* the client has painted the last configure or ran out of time,
+ * send the one held back meanwhile */
+void
+syncdone(Client *client)
+{
+    disarmtimer(&client->cold->synctimer);
+    client->syncwait = 0;
+    if (client->syncqueued) {
+        client->syncqueued = 0;
+        sendconfigure(client);
+    }
+}
+
+void
+syncrequest(Client *client)
+{
+    ClientCold *cold = client->cold;
+    XSyncAlarmAttributes attr;
+    XEvent event;
+
+    cold->syncvalue++;
+    XSyncIntsToValue(&attr.trigger.wait_value, cold->syncvalue & 0xffffffff, cold->syncvalue >> 32);
+    if (cold->syncalarm == None) {
+        attr.trigger.counter = cold->synccounter;
+        attr.trigger.value_type = XSyncAbsolute;
+        attr.trigger.test_type = XSyncPositiveComparison;
+        XSyncIntToValue(&attr.delta, 0);
+        attr.events = True;
+        cold->syncalarm = XSyncCreateAlarm(dpy, XSyncCACounter|XSyncCAValueType|XSyncCAValue
+                                           |XSyncCATestType|XSyncCADelta|XSyncCAEvents, &attr);
+    } else
+        XSyncChangeAlarm(dpy, cold->syncalarm, XSyncCAValue, &attr);
+    event.type = ClientMessage;
+    event.xclient.window = client->win;
+    event.xclient.message_type = wmatom[WMProtocols];
+    event.xclient.format = 32;
+    event.xclient.data.l[0] = wmatom[WMSyncRequest];
+    event.xclient.data.l[1] = CurrentTime;
+    event.xclient.data.l[2] = cold->syncvalue & 0xffffffff;
+    event.xclient.data.l[3] = cold->syncvalue >> 32;
+    event.xclient.data.l[4] = 0;
+    XSendEvent(dpy, client->win, False, NoEventMask, &event);
+    client->syncwait = 1;
+    armtimer(&cold->synctimer, SYNCTIMEOUT);
+}
+
+/* a late ack only ends this request, a busy or frozen client keeps the
+ * protocol; one that keeps missing loses it, otherwise every configure
+ * would wait out the timeout */
+void
+synctimeout(Timer *timer)
+{
+    Client *client = timer->arg;
+
+    if (++client->cold->syncmisses >= SYNCMISSES)
+        client->protocols &= ~(1 << WMSyncRequest);
+    syncdone(client);
+}
+
 int
 stackpos(const Arg *arg) {
-    int n, i;
+    int i;
     Client *client, *l;
 
-    if(!selected_monitor->clients)
+    if(!selected_monitor->visible)
         return -1;
 
     if(arg->i == PREVSEL) {
-        for(l = selected_monitor->stack; l && (!ISVISIBLE(l) || l == selected_monitor->selected_client); l = l->snext);
+        for(l = selected_monitor->vstack; l && l == selected_monitor->selected_client; l = l->vsnext);
         if(!l)
             return -1;
-        for(i = 0, client = selected_monitor->clients; client != l; i += ISVISIBLE(client) ? 1 : 0, client = client->next);
+        for(i = 0, client = selected_monitor->visible; client != l; i++, client = client->vnext);
         return i;
     }
     else if(ISINC(arg->i)) {
-        if(!selected_monitor->selected_client)
+        if(!selected_monitor->selected_client || !ISVISIBLE(selected_monitor->selected_client))
             return -1;
-        for(i = 0, client = selected_monitor->clients; client != selected_monitor->selected_client; i += ISVISIBLE(client) ? 1 : 0, client = client->next);
-        for(n = i; client; n += ISVISIBLE(client) ? 1 : 0, client = client->next);
-        return MOD(i + GETINC(arg->i), n);
-    }
-    else if(arg->i < 0) {
-        for(i = 0, client = selected_monitor->clients; client; i += ISVISIBLE(client) ? 1 : 0, client = client->next);
-        return MAX(i + arg->i, 0);
+        for(i = 0, client = selected_monitor->visible; client != selected_monitor->selected_client; i++, client = client->vnext);
+        return MOD(i + GETINC(arg->i), (int)selected_monitor->nvisible);
     }
+    else if(arg->i < 0)
+        return MAX((int)selected_monitor->nvisible + arg->i, 0);
     else
         return arg->i;
 }
@@ -1828,12 +3439,45 @@ tag(const Arg *arg)
 {
     if (selected_monitor->selected_client && arg->ui & TAGMASK)
     {
+        counttags(selected_monitor->selected_client, -1);
         selected_monitor->selected_client->tags = arg->ui & TAGMASK;
+        counttags(selected_monitor->selected_client, +1);
+        updatecontainer(selected_monitor->selected_client, 1);
+        updatevisible(selected_monitor);
         focus(NULL);
         arrange(selected_monitor);
     }
 }
 
+Window
+tagcontainer(Monitor *monitor, unsigned int tag)
+{
+    XSetWindowAttributes window_attributes = {
+        .override_redirect = True,
+        .background_pixmap = None,
+        .event_mask = SubstructureRedirectMask|SubstructureNotifyMask
+    };
+    XWindowChanges window_changes;
+
+    if (monitor->tagwin[tag])
+        return monitor->tagwin[tag];
+    monitor->tagwin[tag] = XCreateWindow(dpy, root, monitor->mon_x, monitor->mon_y, monitor->mon_width, monitor->mon_height, 0,
+                                         CopyFromParent, InputOutput, CopyFromParent,
+                                         CWOverrideRedirect|CWBackPixmap|CWEventMask, &window_attributes);
+    XShapeCombineRectangles(dpy, monitor->tagwin[tag], ShapeBounding, 0, 0, NULL, 0, ShapeSet, Unsorted);
+    if (monitor->barwin) {
+        window_changes.sibling = monitor->barwin;
+        window_changes.stack_mode = Below;
+        XConfigureWindow(dpy, monitor->tagwin[tag], CWSibling|CWStackMode, &window_changes);
+    }
+    if (monitor->tagset[monitor->seltags] & 1 << tag) {
+        XMapWindow(dpy, monitor->tagwin[tag]);
+        monitor->mappedtags |= 1 << tag;
+    }
+    monitor->nstackorder = 0;
+    return monitor->tagwin[tag];
+}
+
 void
 tagmon(const Arg *arg)
 {
@@ -1848,7 +3492,7 @@ tile(Monitor *monitor)
     unsigned int i, n, h, mw, my, ty;
     Client *client;
 
-    for (n = 0, client = nexttiled(monitor->clients); client; client = nexttiled(client->next), n++);
+    for (n = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), n++);
     if (n == 0)
         return;
 
@@ -1856,7 +3500,7 @@ tile(Monitor *monitor)
         mw = monitor->nmaster ? monitor->window_width * monitor->mfact : 0;
     else
         mw = monitor->window_width;
-    for (i = my = ty = 0, client = nexttiled(monitor->clients); client; client = nexttiled(client->next), i++)
+    for (i = my = ty = 0, client = nexttiled(monitor->visible); client; client = nexttiled(client->vnext), i++)
         if (i < monitor->nmaster) {
             h = (monitor->window_height - my) / (MIN(n, monitor->nmaster) - i);
             resize(client, monitor->window_x, monitor->window_y + my, mw - (2*client->bw), h - (2*client->bw), 0);
@@ -1885,6 +3529,7 @@ togglefloating(const Arg *arg)
     if (selected_monitor->selected_client->isfullscreen) /* no support for fullscreen windows */
         return;
     selected_monitor->selected_client->isfloating = !selected_monitor->selected_client->isfloating || selected_monitor->selected_client->isfixed;
+    updatecontainer(selected_monitor->selected_client, 1);
     if (selected_monitor->selected_client->isfloating)
         resize(selected_monitor->selected_client, selected_monitor->selected_client->x_pos, selected_monitor->selected_client->y_pos,
                selected_monitor->selected_client->width, selected_monitor->selected_client->height, 0);
@@ -1900,7 +3545,11 @@ toggletag(const Arg *arg)
         return;
     newtags = selected_monitor->selected_client->tags ^ (arg->ui & TAGMASK);
     if (newtags) {
+        counttags(selected_monitor->selected_client, -1);
         selected_monitor->selected_client->tags = newtags;
+        counttags(selected_monitor->selected_client, +1);
+        updatecontainer(selected_monitor->selected_client, 1);
+        updatevisible(selected_monitor);
         focus(NULL);
         arrange(selected_monitor);
     }
@@ -1913,8 +3562,46 @@ toggleview(const Arg *arg)
 
     if (newtagset) {
         selected_monitor->tagset[selected_monitor->seltags] = newtagset;
+        updatevisible(selected_monitor);
         focus(NULL);
         arrange(selected_monitor);
+        ipcnotifytags(selected_monitor);
+    }
+}
+
+/* keep pointer_x/pointer_y current from the root coordinates that
+ * input and crossing events carry, so nothing has to query the pointer */
+void
+trackpointer(XEvent *event)
+{
+    switch (event->type) {
+    case KeyPress:
+    case KeyRelease:
+        if (event->xkey.same_screen) {
+            pointer_x = event->xkey.x_root;
+            pointer_y = event->xkey.y_root;
+        }
+        break;
+    case ButtonPress:
+    case ButtonRelease:
+        if (event->xbutton.same_screen) {
+            pointer_x = event->xbutton.x_root;
+            pointer_y = event->xbutton.y_root;
+        }
+        break;
+    case MotionNotify:
+        if (event->xmotion.same_screen) {
+            pointer_x = event->xmotion.x_root;
+            pointer_y = event->xmotion.y_root;
+        }
+        break;
+    case EnterNotify:
+    case LeaveNotify:
+        if (event->xcrossing.same_screen) {
+            pointer_x = event->xcrossing.x_root;
+            pointer_y = event->xcrossing.y_root;
+        }
+        break;
     }
 }
 
@@ -1940,20 +3627,34 @@ unmanage(Client *client, int destroyed)
     /* The server grab construct avoids race conditions. */
     detach(client);
     detachstack(client);
+    if (client->cold->container)
+        markshape(client->cold->container);
     if (!destroyed) {
-        wc.border_width = client->oldbw;
+        wc.border_width = client->cold->oldbw;
         XGrabServer(dpy);
         XSetErrorHandler(xerrordummy);
+        if (client->cold->container) /* back to the root before its container goes */
+            XReparentWindow(dpy, client->win, root, client->x_pos, client->y_pos);
         XConfigureWindow(dpy, client->win, CWBorderWidth, &wc); /* restore border */
         XUngrabButton(dpy, AnyButton, AnyModifier, client->win);
+        if (client->ishidden) {
+            client->ishidden = 0;
+            updatenetstate(client);
+        }
         setclientstate(client, WithdrawnState);
         XSync(dpy, False);
         XSetErrorHandler(xerror);
         XUngrabServer(dpy);
     }
-    free(client);
+    if (client == cgfocused)
+        cgfocused = NULL;
+    if (client->cgclass != CgNone)
+        cg_detach(client->cold->pid, client->cgclass);
+    ipcevent(IpcEvClient, "client remove 0x%lx\n", client->win);
+    freeclient(client);
     focus(NULL);
     updateclientlist();
+    updatestats();
     arrange(m);
 }
 
@@ -1966,7 +3667,11 @@ unmapnotify(XEvent *event)
     if ((client = wintoclient(unmap_event->window))) {
         if (unmap_event->send_event)
             setclientstate(client, WithdrawnState);
-        else
+        else if (client->cold->ignoreunmap) {
+            /* reported to the window and its old parent, count the latter */
+            if (unmap_event->event != client->win)
+                client->cold->ignoreunmap--;
+        } else
             unmanage(client, 0);
     }
 }
@@ -1978,7 +3683,11 @@ updatebars(void)
     XSetWindowAttributes window_attributes = {
         .override_redirect = True,
         .background_pixmap = ParentRelative,
-        .event_mask = ButtonPressMask|ExposureMask
+        .event_mask = ButtonPressMask|ExposureMask|EnterWindowMask
+    };
+    XSetWindowAttributes desk_attributes = {
+        .override_redirect = True,
+        .event_mask = EnterWindowMask
     };
     for (monitor = monitor_start; monitor; monitor = monitor->next) {
         if (monitor->barwin)
@@ -1988,12 +3697,19 @@ updatebars(void)
                                   CWOverrideRedirect|CWBackPixmap|CWEventMask, &window_attributes);
         XDefineCursor(dpy, monitor->barwin, cursor[CurNormal]->cursor);
         XMapRaised(dpy, monitor->barwin);
+        /* the pointer entering a monitor's desktop selects that monitor,
+         * clicks pass through to the root window */
+        monitor->deskwin = XCreateWindow(dpy, root, monitor->mon_x, monitor->mon_y, monitor->mon_width, monitor->mon_height, 0, 0,
+                                  InputOnly, CopyFromParent, CWOverrideRedirect|CWEventMask, &desk_attributes);
+        XLowerWindow(dpy, monitor->deskwin);
+        XMapWindow(dpy, monitor->deskwin);
     }
 }
 
 void
 updatebarpos(Monitor *monitor)
 {
+    monitor->dirty = 1;
     monitor->window_y = monitor->mon_y;
     monitor->window_height = monitor->mon_height;
     if (monitor->showbar) {
@@ -2004,6 +3720,24 @@ updatebarpos(Monitor *monitor)
         monitor->bar_y = -bar_height;
 }
 
+/* moves the client's process to the weight of its focus and visibility */
+void
+updatecgroup(Client *client)
+{
+    int class;
+
+    if (!cgroups || !client->cold->pid)
+        return;
+    class = client == cgfocused ? CgFocused : ISVISIBLE(client) ? CgVisible : CgHidden;
+    if (class == client->cgclass)
+        return;
+    if (client->cgclass == CgNone)
+        cg_attach(client->cold->pid, class);
+    else
+        cg_setclass(client->cold->pid, client->cgclass, class);
+    client->cgclass = class;
+}
+
 void
 updateclientlist()
 {
@@ -2018,6 +3752,57 @@ updateclientlist()
                             (unsigned char *) &(c->win), 1);
 }
 
+/* tiled clients with a single tag live in that tag's container, switching
+ * tags then only maps and unmaps containers, floating clients and clients
+ * with several tags stay on the root and are moved off screen as usual */
+void
+updatecontainer(Client *client, int mapped)
+{
+    ClientCold *cold = client->cold;
+    Window parent = None;
+    unsigned int i;
+
+    if (!containers)
+        return;
+    if (!client->isfloating && client->tags && !(client->tags & (client->tags - 1))) {
+        for (i = 0; !(client->tags & 1 << i); i++);
+        parent = tagcontainer(client->mon, i);
+    }
+    if (parent == cold->container)
+        return;
+    if (cold->container)
+        markshape(cold->container);
+    if (mapped)
+        cold->ignoreunmap++; /* reparenting unmaps and maps it again */
+    if (!parent && !ISVISIBLE(client))
+        client->isshown = 0;
+    cold->container = parent;
+    XAddToSaveSet(dpy, client->win);
+    XReparentWindow(dpy, client->win, parent ? parent : root,
+                    client->isshown ? WINX(client) : WIDTH(client) * -2, WINY(client));
+    if (parent)
+        markshape(parent);
+}
+
+/* rebuilt whenever monitors come, go or move, num is the list position */
+void
+updatemonindex(void)
+{
+    unsigned int i, j;
+    Monitor *m;
+
+    for (nmons = 0, m = monitor_start; m; m = m->next, nmons++);
+    monbynum = erealloc(monbynum, nmons * sizeof(Monitor *));
+    monbyx = erealloc(monbyx, nmons * sizeof(Monitor *));
+    for (i = 0, m = monitor_start; m; m = m->next, i++) {
+        monbynum[i] = m;
+        for (j = i; j > 0 && monbyx[j - 1]->window_x > m->window_x; j--)
+            monbyx[j] = monbyx[j - 1];
+        monbyx[j] = m;
+    }
+    lasthit = NULL;
+}
+
 int
 updategeom(void)
 {
@@ -2067,16 +3852,18 @@ updategeom(void)
                 while (monitor->clients) {
                     dirty = 1;
                     client = monitor->clients;
-                    monitor->clients = client->next;
+                    detach(client);
                     detachstack(client);
                     client->mon = monitor_start;
                     attach(client);
                     attachstack(client);
+                    updatecontainer(client, 1);
                 }
                 if (monitor == selected_monitor)
                     selected_monitor = monitor_start;
                 cleanupmon(monitor);
             }
+            updatevisible(monitor_start);
         }
         free(unique);
     } else
@@ -2092,13 +3879,83 @@ updategeom(void)
             updatebarpos(monitor_start);
         }
     }
+    updatemonindex();
     if (dirty) {
         selected_monitor = monitor_start;
         selected_monitor = wintomon(root);
     }
+#ifdef XRANDR
+    updaterefresh();
+#endif /* XRANDR */
     return dirty;
 }
 
+#ifdef XRANDR
+void
+updaterefresh(void)
+{
+    int i, j;
+    unsigned int hz;
+    double vtotal;
+    Monitor *m;
+    XRRScreenResources *res;
+    XRRCrtcInfo *crtc;
+    XRRModeInfo *mode;
+
+    if (rrevent < 0 || !(res = XRRGetScreenResourcesCurrent(dpy, root)))
+        return;
+    for (m = monitor_start; m; m = m->next)
+        m->refresh = 0;
+    for (i = 0; i < res->ncrtc; i++) {
+        if (!(crtc = XRRGetCrtcInfo(dpy, res, res->crtcs[i])))
+            continue;
+        for (j = 0; crtc->mode != None && j < res->nmode; j++) {
+            mode = &res->modes[j];
+            if (mode->id != crtc->mode || !mode->hTotal || !mode->vTotal)
+                continue;
+            vtotal = mode->vTotal;
+            if (mode->modeFlags & RR_DoubleScan)
+                vtotal *= 2;
+            if (mode->modeFlags & RR_Interlace)
+                vtotal /= 2;
+            hz = mode->dotClock / (mode->hTotal * vtotal) + 0.5;
+            /* a mirrored monitor is paced by its fastest crtc */
+            for (m = monitor_start; m; m = m->next)
+                if (INTERSECT(crtc->x, crtc->y, (int)crtc->width, (int)crtc->height, m) > 0 && hz > m->refresh)
+                    m->refresh = hz;
+            break;
+        }
+        XRRFreeCrtcInfo(crtc);
+    }
+    XRRFreeScreenResources(res);
+    for (m = monitor_start; m; m = m->next)
+        if (!m->refresh)
+            m->refresh = 60;
+}
+#endif /* XRANDR */
+
+void
+updatenetstate(Client *client)
+{
+    ClientCold *cold = client->cold;
+    Atom *state;
+    int n = 0;
+
+    /* the atoms dwm sets, then the ones others set as they were read last */
+    state = ecalloc(cold->nnetstate + 2, sizeof(Atom));
+    if (client->isfullscreen)
+        state[n++] = netatom[NetWMFullscreen];
+    if (client->ishidden)
+        state[n++] = netatom[NetWMStateHidden];
+    memcpy(state + n, cold->netstate, cold->nnetstate * sizeof(Atom));
+    n += cold->nnetstate;
+    client->winstate = n ? state[0] : None;
+    cold->stateserial = NextRequest(dpy);
+    XChangeProperty(dpy, client->win, netatom[NetWMState], XA_ATOM, 32,
+                    PropModeReplace, (unsigned char *)state, n);
+    free(state);
+}
+
 void
 updatenumlockmask(void)
 {
@@ -2115,6 +3972,24 @@ updatenumlockmask(void)
     XFreeModifiermap(modmap);
 }
 
+void
+updateprotocols(Client *client)
+{
+    int i, n;
+    Atom *protocols;
+
+    client->protocols = 0;
+    if (XGetWMProtocols(dpy, client->win, &protocols, &n)) {
+        while (n--)
+            for (i = 0; i < WMLast; i++)
+                if (protocols[n] == wmatom[i])
+                    client->protocols |= 1 << i;
+        XFree(protocols);
+    }
+    if (client->protocols & (1 << WMSyncRequest))
+        updatesynccounter(client);
+}
+
 void
 updatesizehints(Client *client)
 {
@@ -2125,75 +4000,225 @@ updatesizehints(Client *client)
         /* size is uninitialized, ensure that size.flags aren't used */
         size.flags = PSize;
     if (size.flags & PBaseSize) {
-        client->basew = size.base_width;
-        client->baseh = size.base_height;
+        client->cold->basew = size.base_width;
+        client->cold->baseh = size.base_height;
     } else if (size.flags & PMinSize) {
-        client->basew = size.min_width;
-        client->baseh = size.min_height;
+        client->cold->basew = size.min_width;
+        client->cold->baseh = size.min_height;
     } else
-        client->basew = client->baseh = 0;
+        client->cold->basew = client->cold->baseh = 0;
     if (size.flags & PResizeInc) {
-        client->incw = size.width_inc;
-        client->inch = size.height_inc;
+        client->cold->incw = size.width_inc;
+        client->cold->inch = size.height_inc;
     } else
-        client->incw = client->inch = 0;
+        client->cold->incw = client->cold->inch = 0;
     if (size.flags & PMaxSize) {
-        client->maxw = size.max_width;
-        client->maxh = size.max_height;
+        client->cold->maxw = size.max_width;
+        client->cold->maxh = size.max_height;
     } else
-        client->maxw = client->maxh = 0;
+        client->cold->maxw = client->cold->maxh = 0;
     if (size.flags & PMinSize) {
-        client->minw = size.min_width;
-        client->minh = size.min_height;
+        client->cold->minw = size.min_width;
+        client->cold->minh = size.min_height;
     } else if (size.flags & PBaseSize) {
-        client->minw = size.base_width;
-        client->minh = size.base_height;
+        client->cold->minw = size.base_width;
+        client->cold->minh = size.base_height;
     } else
-        client->minw = client->minh = 0;
+        client->cold->minw = client->cold->minh = 0;
     if (size.flags & PAspect) {
-        client->mina = (float)size.min_aspect.y / size.min_aspect.x;
-        client->maxa = (float)size.max_aspect.x / size.max_aspect.y;
+        client->cold->mina = (float)size.min_aspect.y / size.min_aspect.x;
+        client->cold->maxa = (float)size.max_aspect.x / size.max_aspect.y;
     } else
-        client->maxa = client->mina = 0.0;
-    client->isfixed = (client->maxw && client->minw && client->maxh && client->minh
-                 && client->maxw == client->minw && client->maxh == client->minh);
+        client->cold->maxa = client->cold->mina = 0.0;
+    client->isfixed = (client->cold->maxw && client->cold->minw && client->cold->maxh && client->cold->minh
+                 && client->cold->maxw == client->cold->minw && client->cold->maxh == client->cold->minh);
+    invalidateplans(client->mon);
 }
 
 void
 updatetitle(Client *client)
 {
-    if (!gettextprop(client->win, netatom[NetWMName], client->name, sizeof client->name))
-        gettextprop(client->win, XA_WM_NAME, client->name, sizeof client->name);
-    if (client->name[0] == '\0') /* hack to mark broken clients */
-        strcpy(client->name, broken);
+    if (!gettextprop(client->win, netatom[NetWMName], client->cold->name, sizeof client->cold->name))
+        gettextprop(client->win, XA_WM_NAME, client->cold->name, sizeof client->cold->name);
+    if (client->cold->name[0] == '\0') /* hack to mark broken clients */
+        strcpy(client->cold->name, broken);
+}
+
+/* publishes allocator counters on the root window, read them with
+ * xprop -root _DWM_STATS */
+void
+updatestats(void)
+{
+    char buf[128];
+
+    if (!dwmatom[DWMStats])
+        return;
+    snprintf(buf, sizeof buf, "clients %zu peak %zu monitors %zu peak %zu",
+             clientslab.live, clientslab.peak, monslab.live, monslab.peak);
+    XChangeProperty(dpy, root, dwmatom[DWMStats], XA_STRING, 8,
+                    PropModeReplace, (unsigned char *)buf, strlen(buf));
 }
 
 /* here is what is drawn to status  */
 void
 updatestatus(void)
 {
-    /*parse this file to get info
-     *FILE* status = fopen( "/proc/self/status", "r" );
-     * but it must keep running not just when screen is focused
-     **/
-
+    /* the built-in modules and statusfifo own stext */
+    if (builtinstatus || statusfd >= 0)
+        return;
     if (!gettextprop(root, XA_WM_NAME, stext, sizeof(stext)))
         strcpy(stext, "dwm-"VERSION);
     drawbar(selected_monitor);
 }
 
+/* applies screen changes once they settled, only monitors whose geometry
+ * changed get their bar moved and their clients rearranged */
+void
+updatetopology(Timer *timer)
+{
+    Monitor *monitor;
+    unsigned int i;
+    int resized = drw->w != (unsigned int)screen_width;
+
+    if (!updategeom() && !resized)
+        return;
+    if (resized)
+        drw_resize(drw, screen_width, bar_height);
+    updatebars();
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        if (monitor->dirty) {
+            XMoveResizeWindow(dpy, monitor->barwin, monitor->window_x, monitor->bar_y, monitor->window_width, bar_height);
+            XMoveResizeWindow(dpy, monitor->deskwin, monitor->mon_x, monitor->mon_y, monitor->mon_width, monitor->mon_height);
+            for (i = 0; i < LENGTH(tags); i++)
+                if (monitor->tagwin[i]) {
+                    XMoveResizeWindow(dpy, monitor->tagwin[i], monitor->mon_x, monitor->mon_y, monitor->mon_width, monitor->mon_height);
+                    markshape(monitor->tagwin[i]);
+                }
+        }
+    focus(NULL);
+    arrange(NULL);
+}
+
+void
+updatesynccounter(Client *client)
+{
+    ClientCold *cold = client->cold;
+    XSyncCounter counter = None;
+    XSyncValue value;
+    int di;
+    unsigned long dl;
+    unsigned char *p = NULL;
+    Atom da;
+
+    if (syncevent >= 0 && XGetWindowProperty(dpy, client->win, netatom[NetWMSyncRequestCounter], 0L, 1L, False,
+                                             XA_CARDINAL, &da, &di, &dl, &dl, &p) == Success && p) {
+        counter = *(long *)p;
+        XFree(p);
+    }
+    if (counter != cold->synccounter) {
+        if (cold->syncalarm != None)
+            XSyncDestroyAlarm(dpy, cold->syncalarm);
+        cold->syncalarm = None;
+        cold->syncmisses = 0;
+        if ((cold->synccounter = counter) != None && XSyncQueryCounter(dpy, counter, &value))
+            cold->syncvalue = (unsigned long long)(unsigned int)XSyncValueHigh32(value) << 32 | XSyncValueLow32(value);
+    }
+    if (counter == None)
+        client->protocols &= ~(1 << WMSyncRequest);
+}
+
+/* rebuilds the visible subsets after a tagset or client tags change and
+ * moves clients that left the view off screen */
+void
+updatevisible(Monitor *monitor)
+{
+    Client *client, *last;
+    unsigned int i, tagset = monitor->tagset[monitor->seltags];
+
+    /* clients in containers are hidden along with their container */
+    for (i = 0; i < LENGTH(tags); i++)
+        if (monitor->tagwin[i] && (tagset & 1 << i) && !(monitor->mappedtags & 1 << i))
+            XMapWindow(dpy, monitor->tagwin[i]);
+    for (i = 0; i < LENGTH(tags); i++)
+        if (monitor->tagwin[i] && !(tagset & 1 << i) && (monitor->mappedtags & 1 << i))
+            XUnmapWindow(dpy, monitor->tagwin[i]);
+    monitor->mappedtags = tagset;
+    monitor->nvisible = 0;
+    for (last = NULL, client = monitor->clients; client; client = client->next) {
+        client->vprev = client->vnext = NULL;
+        if (!ISVISIBLE(client)) {
+            if (client->isshown && !client->cold->container) {
+                XMoveWindow(dpy, client->win, WIDTH(client) * -2, client->y_pos);
+                client->isshown = 0;
+            }
+            if (hiddenstate && !client->ishidden)
+                sethidden(client, 1);
+            updatecgroup(client);
+            continue;
+        }
+        if (client->ishidden)
+            sethidden(client, 0);
+        updatecgroup(client);
+        if ((client->vprev = last))
+            last->vnext = client;
+        else
+            monitor->visible = client;
+        last = client;
+        monitor->nvisible++;
+    }
+    if (!last)
+        monitor->visible = NULL;
+    for (last = NULL, client = monitor->stack; client; client = client->snext) {
+        client->vsprev = client->vsnext = NULL;
+        if (!ISVISIBLE(client))
+            continue;
+        if ((client->vsprev = last))
+            last->vsnext = client;
+        else
+            monitor->vstack = client;
+        last = client;
+    }
+    if (!last)
+        monitor->vstack = NULL;
+}
+
 void
 updatewindowtype(Client *client)
 {
-    Atom state = getatomprop(client, netatom[NetWMState]);
-    Atom wtype = getatomprop(client, netatom[NetWMWindowType]);
+    updatewinstate(client);
+    client->wintype = getatomprop(client, netatom[NetWMWindowType]);
 
-    if (state == netatom[NetWMFullscreen])
+    if (client->winstate == netatom[NetWMFullscreen])
         setfullscreen(client, 1);
-    if (wtype == netatom[NetWMWindowTypeDialog])
+    if (client->wintype == netatom[NetWMWindowTypeDialog])
         client->isfloating = 1;
 }
 
+/* rereads _NET_WM_STATE, keeping the atoms updatenetstate() does not own */
+void
+updatewinstate(Client *client)
+{
+    ClientCold *cold = client->cold;
+    int di;
+    unsigned long i, n = 0, dl;
+    unsigned char *p = NULL;
+    Atom da, *atoms;
+
+    client->winstate = None;
+    cold->nnetstate = 0;
+    if (XGetWindowProperty(dpy, client->win, netatom[NetWMState], 0L, 64L, False, XA_ATOM,
+                           &da, &di, &n, &dl, &p) != Success || !p)
+        return;
+    atoms = (Atom *)p;
+    if (n)
+        client->winstate = atoms[0];
+    cold->netstate = erealloc(cold->netstate, (n ? n : 1) * sizeof(Atom));
+    for (i = 0; i < n; i++)
+        if (atoms[i] != netatom[NetWMFullscreen] && atoms[i] != netatom[NetWMStateHidden])
+            cold->netstate[cold->nnetstate++] = atoms[i];
+    XFree(p);
+}
+
 void
 updatewmhints(Client *client)
 {
@@ -2204,7 +4229,7 @@ updatewmhints(Client *client)
             wmh->flags &= ~XUrgencyHint;
             XSetWMHints(dpy, client->win, wmh);
         } else
-            client->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
+            seturgent(client, (wmh->flags & XUrgencyHint) ? 1 : 0);
         if (wmh->flags & InputHint)
             client->neverfocus = !wmh->input;
         else
@@ -2213,6 +4238,48 @@ updatewmhints(Client *client)
     }
 }
 
+/* grows usagebuf rather than cutting a line short */
+void
+usageappend(size_t *len, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    for (;;) {
+        va_start(ap, fmt);
+        n = vsnprintf(usagebuf + *len, usagebufsize - *len, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return;
+        if (*len + n < usagebufsize) {
+            *len += n;
+            return;
+        }
+        usagebuf = erealloc(usagebuf, (usagebufsize = 2 * (*len + n + 1)));
+    }
+}
+
+void
+usagetext(Monitor *monitor, char *text, size_t size)
+{
+    Client *client, *c;
+    unsigned int cpu = 0;
+    unsigned long rss = 0;
+    int n = 0;
+
+    if ((client = monitor->selected_client))
+        n = snprintf(text, size, "%u%% %luM | ", client->cold->cpu / 10, client->cold->rss / 1024);
+    /* a process with several windows in view counts once */
+    for (client = monitor->visible; client; client = client->vnext) {
+        for (c = monitor->visible; c != client && c->cold->pid != client->cold->pid; c = c->vnext);
+        if (c != client)
+            continue;
+        cpu += client->cold->cpu;
+        rss += client->cold->rss;
+    }
+    snprintf(text + n, size - n, "%u%% %luM", cpu / 10, rss / 1024);
+}
+
 void
 view(const Arg *arg)
 {
@@ -2221,29 +4288,31 @@ view(const Arg *arg)
     selected_monitor->seltags ^= 1; /* toggle sel tagset */
     if (arg->ui & TAGMASK)
         selected_monitor->tagset[selected_monitor->seltags] = arg->ui & TAGMASK;
+    updatevisible(selected_monitor);
     focus(NULL);
     arrange(selected_monitor);
+    ipcnotifytags(selected_monitor);
 }
 
 /* bring mouse pointer to client */
 void
 warp(const Client *client)
 {
-    int x, y;
+    int x = pointer_x, y = pointer_y;
 
     if (!client)
     {
-        XWarpPointer(dpy, None, root, 0, 0, 0, 0, selected_monitor->window_x + selected_monitor->window_width/2, selected_monitor->window_y + selected_monitor->window_height/2);
+        pointer_x = selected_monitor->window_x + selected_monitor->window_width/2;
+        pointer_y = selected_monitor->window_y + selected_monitor->window_height/2;
+        XWarpPointer(dpy, None, root, 0, 0, 0, 0, pointer_x, pointer_y);
         return;
     }
 
-    Atom wtype = getatomprop((Client *)client, netatom[NetWMWindowType]);
-    if (wtype == netatom[NetWMWindowTypeDialog] ||
-        wtype == netatom[NetWMWindowTypeNotification])
+    if (client->wintype == netatom[NetWMWindowTypeDialog] ||
+        client->wintype == netatom[NetWMWindowTypeNotification])
         return;
 
-    if (!getrootptr(&x, &y) ||
-        (x > client->x_pos - client->bw &&
+    if ((x > client->x_pos - client->bw &&
          y > client->y_pos - client->bw &&
          x < client->x_pos + client->width + client->bw*2 &&
          y < client->y_pos + client->height + client->bw*2) ||
@@ -2252,6 +4321,8 @@ warp(const Client *client)
         return;
 
     XWarpPointer(dpy, None, client->win, 0, 0, 0, 0, client->width / 2, client->height / 2);
+    pointer_x = client->x_pos + client->bw + client->width / 2;
+    pointer_y = client->y_pos + client->bw + client->height / 2;
 }
 
 
@@ -2268,17 +4339,27 @@ wintoclient(Window window)
     return NULL;
 }
 
+Monitor *
+wintodesk(Window window)
+{
+    Monitor *monitor;
+
+    for (monitor = monitor_start; monitor; monitor = monitor->next)
+        if (window == monitor->deskwin)
+            return monitor;
+    return NULL;
+}
+
 Monitor *
 wintomon(Window window)
 {
-    int x_pos, y_pos;
     Client *client;
     Monitor *monitor;
 
-    if (window == root && getrootptr(&x_pos, &y_pos))
-        return recttomon(x_pos, y_pos, 1, 1);
+    if (window == root)
+        return recttomon(pointer_x, pointer_y, 1, 1);
     for (monitor = monitor_start; monitor; monitor = monitor->next)
-        if (window == monitor->barwin)
+        if (window == monitor->barwin || window == monitor->deskwin)
             return monitor;
     if ((client = wintoclient(window)))
         return client->mon;
@@ -2299,7 +4380,9 @@ xerror(Display *dpy, XErrorEvent *error_event)
     || (error_event->request_code == X_ConfigureWindow && error_event->error_code == BadMatch)
     || (error_event->request_code == X_GrabButton && error_event->error_code == BadAccess)
     || (error_event->request_code == X_GrabKey && error_event->error_code == BadAccess)
-    || (error_event->request_code == X_CopyArea && error_event->error_code == BadDrawable))
+    || (error_event->request_code == X_CopyArea && error_event->error_code == BadDrawable)
+    || (syncerror >= 0 && (error_event->error_code == syncerror + XSyncBadCounter
+                           || error_event->error_code == syncerror + XSyncBadAlarm)))
         return 0;
     fprintf(stderr, "dwm: fatal error: request code=%d, error code=%d\n",
             error_event->request_code, error_event->error_code);
@@ -2329,8 +4412,8 @@ zoom(const Arg *arg)
     if (!selected_monitor->lt[selected_monitor->sellt]->arrange
     || (selected_monitor->selected_client && selected_monitor->selected_client->isfloating))
         return;
-    if (client == nexttiled(selected_monitor->clients))
-        if (!client || !(client = nexttiled(client->next)))
+    if (client == nexttiled(selected_monitor->visible))
+        if (!client || !(client = nexttiled(client->vnext)))
             return;
     pop(client);
 }
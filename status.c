@@ -0,0 +1,165 @@
+/* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "status.h"
+
+/* rereads a file through the module's fd, opening it on first use */
+static char *
+readfile(StatusState *st, const char *path, char *buf, size_t size)
+{
+	ssize_t n;
+
+	if (st->fd < 0 && (st->fd = open(path, O_RDONLY|O_CLOEXEC)) < 0)
+		return NULL;
+	if ((n = pread(st->fd, buf, size - 1, 0)) <= 0) {
+		close(st->fd);
+		st->fd = -1;
+		return NULL;
+	}
+	buf[n] = '\0';
+	return buf;
+}
+
+static long long
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void
+human(char *buf, size_t size, unsigned long long n)
+{
+	const char *units = "BKMGT";
+
+	while (n >= 10240 && units[1]) {
+		n /= 1024;
+		units++;
+	}
+	snprintf(buf, size, "%llu%c", n, *units);
+}
+
+void
+st_battery(StatusState *st, const char *arg, char *buf, size_t size)
+{
+	char path[128], file[16];
+
+	snprintf(path, sizeof path, "/sys/class/power_supply/%s/capacity", arg);
+	if (!readfile(st, path, file, sizeof file)) {
+		snprintf(buf, size, "bat ?");
+		return;
+	}
+	file[strcspn(file, "\n")] = '\0';
+	snprintf(buf, size, "bat %s%%", file);
+}
+
+void
+st_clock(StatusState *st, const char *arg, char *buf, size_t size)
+{
+	time_t t = time(NULL);
+
+	if (!strftime(buf, size, arg, localtime(&t)))
+		buf[0] = '\0';
+}
+
+void
+st_cpu(StatusState *st, const char *arg, char *buf, size_t size)
+{
+	char file[256];
+	unsigned long long v[8], total = 0, idle;
+	int i;
+
+	if (!readfile(st, "/proc/stat", file, sizeof file)
+	|| sscanf(file, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+	          &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) != 8) {
+		snprintf(buf, size, "cpu ?");
+		return;
+	}
+	for (i = 0; i < 8; i++)
+		total += v[i];
+	idle = v[3] + v[4];
+	snprintf(buf, size, "cpu %llu%%", total > st->a
+	         ? 100 - (idle - st->b) * 100 / (total - st->a) : 0);
+	st->a = total;
+	st->b = idle;
+}
+
+void
+st_load(StatusState *st, const char *arg, char *buf, size_t size)
+{
+	char file[64];
+	double load;
+
+	if (!readfile(st, "/proc/loadavg", file, sizeof file)
+	|| sscanf(file, "%lf", &load) != 1) {
+		snprintf(buf, size, "load ?");
+		return;
+	}
+	snprintf(buf, size, "load %.2f", load);
+}
+
+void
+st_mem(StatusState *st, const char *arg, char *buf, size_t size)
+{
+	char file[512], used[16], *p;
+	unsigned long long total, avail;
+
+	if (!readfile(st, "/proc/meminfo", file, sizeof file)
+	|| sscanf(file, "MemTotal: %llu kB", &total) != 1
+	|| !(p = strstr(file, "MemAvailable:"))
+	|| sscanf(p, "MemAvailable: %llu kB", &avail) != 1) {
+		snprintf(buf, size, "mem ?");
+		return;
+	}
+	human(used, sizeof used, (total - avail) * 1024);
+	snprintf(buf, size, "mem %s", used);
+}
+
+void
+st_net(StatusState *st, const char *arg, char *buf, size_t size)
+{
+	static char *file;
+	static size_t filesize = 4096;
+	char name[32], rx[16], tx[16], *p = NULL;
+	unsigned long long rxb, txb;
+	long long t = now(), dt;
+	size_t len;
+
+	/* one line per interface, grow until the whole file fits */
+	for (;;) {
+		if (!file && !(file = malloc(filesize)))
+			break;
+		if (!(p = readfile(st, "/proc/net/dev", file, filesize))
+		|| strlen(file) < filesize - 1)
+			break;
+		free(file);
+		file = NULL;
+		filesize *= 2;
+	}
+	/* names are right aligned, "eth0:" must not match "veth0:" */
+	len = snprintf(name, sizeof name, "%s:", arg);
+	for (; p; p = (p = strchr(p, '\n')) ? p + 1 : NULL) {
+		p += strspn(p, " ");
+		if (!strncmp(p, name, len))
+			break;
+	}
+	if (!p || sscanf(p + len, "%llu %*u %*u %*u %*u %*u %*u %*u %llu", &rxb, &txb) != 2) {
+		snprintf(buf, size, "%s ?", arg);
+		return;
+	}
+	/* a counter that went back (reset, new interface) has no rate */
+	dt = st->when ? t - st->when : 0;
+	human(rx, sizeof rx, dt > 0 && rxb >= st->a ? (rxb - st->a) * 1000 / dt : 0);
+	human(tx, sizeof tx, dt > 0 && txb >= st->b ? (txb - st->b) * 1000 / dt : 0);
+	snprintf(buf, size, "%s %s/s %s/s", arg, rx, tx);
+	st->a = rxb;
+	st->b = txb;
+	st->when = t;
+}
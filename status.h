@@ -0,0 +1,22 @@
+/* See LICENSE file for copyright and license details. */
+
+/* what a module keeps between runs */
+typedef struct {
+	int fd;                        /* persistent, -1 until opened */
+	unsigned long long a, b;       /* previous counters */
+	long long when;                /* monotonic ms of the previous counters */
+} StatusState;
+
+typedef struct {
+	void (*fn)(StatusState *st, const char *arg, char *buf, size_t size);
+	const char *arg;
+	unsigned int interval;         /* ms */
+} StatusModule;
+
+/* status modules, each writes its text to buf */
+void st_battery(StatusState *st, const char *arg, char *buf, size_t size);
+void st_clock(StatusState *st, const char *arg, char *buf, size_t size);
+void st_cpu(StatusState *st, const char *arg, char *buf, size_t size);
+void st_load(StatusState *st, const char *arg, char *buf, size_t size);
+void st_mem(StatusState *st, const char *arg, char *buf, size_t size);
+void st_net(StatusState *st, const char *arg, char *buf, size_t size);
@@ -16,6 +16,14 @@ ecalloc(size_t nmemb, size_t size)
 	return p;
 }
 
+void *
+erealloc(void *p, size_t size)
+{
+	if (!(p = realloc(p, size)))
+		die("realloc:");
+	return p;
+}
+
 void
 die(const char *fmt, ...) {
 	va_list ap;
@@ -31,3 +39,49 @@ die(const char *fmt, ...) {
 
 	exit(1);
 }
+
+void *
+slab_alloc(Slab *slab)
+{
+	char *chunk;
+	void *p;
+	size_t i;
+
+	if (!slab->free) {
+		if (!(chunk = calloc(slab->perchunk, slab->size)))
+			die("calloc:");
+		slab->chunks = erealloc(slab->chunks, (slab->nchunks + 1) * sizeof(void *));
+		slab->chunks[slab->nchunks++] = chunk;
+		for (i = slab->perchunk; i--; ) {
+			*(void **)(chunk + i * slab->size) = slab->free;
+			slab->free = chunk + i * slab->size;
+		}
+	}
+	p = slab->free;
+	slab->free = *(void **)p;
+	memset(p, 0, slab->size);
+	if (++slab->live > slab->peak)
+		slab->peak = slab->live;
+	return p;
+}
+
+void
+slab_free(Slab *slab, void *p)
+{
+	if (!p)
+		return;
+	*(void **)p = slab->free;
+	slab->free = p;
+	slab->live--;
+}
+
+void
+slab_destroy(Slab *slab)
+{
+	while (slab->nchunks)
+		free(slab->chunks[--slab->nchunks]);
+	free(slab->chunks);
+	slab->chunks = NULL;
+	slab->free = NULL;
+	slab->live = 0;
+}
@@ -4,5 +4,20 @@
 #define MIN(A, B)               ((A) < (B) ? (A) : (B))
 #define BETWEEN(X, A, B)        ((A) <= (X) && (X) <= (B))
 
+typedef struct {
+	size_t size;     /* object size */
+	size_t perchunk; /* objects per contiguous chunk */
+	void *free;      /* free objects, linked through their first word */
+	void **chunks;
+	size_t nchunks;
+	size_t live, peak;
+} Slab;
+
 void die(const char *errstr, ...);
 void *ecalloc(size_t, size_t);
+void *erealloc(void *, size_t);
+
+/* fixed-size object slabs */
+void *slab_alloc(Slab *);
+void slab_free(Slab *, void *);
+void slab_destroy(Slab *);